@@ -1,14 +1,19 @@
 struct buf;
 struct context;
+struct cpu;
 struct file;
 struct inode;
 struct pipe;
 struct proc;
+struct procheap;
+struct schedclass;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct timer;
 struct pinfo;
+struct memstat;
 
 // bio.c
 void            binit(void);
@@ -62,7 +67,9 @@ void            ramdiskrw(struct buf*);
 
 // kalloc.c
 void*           kalloc(void);
+void*           kallockind(int);
 void            kfree(void *);
+void            kmemstat(struct memstat*);
 void            kinit(void);
 
 // log.c
@@ -71,6 +78,14 @@ void            log_write(struct buf*);
 void            begin_op(void);
 void            end_op(void);
 
+// mm.c
+void            mminit(void);
+struct mm*      mmalloc(void);
+struct mm*      mmdup(struct mm*);
+void            mmput(struct mm*);
+int             mmgrow(struct mm*, uint64, uint64);
+void            mmshrink(struct mm*, uint64, uint64);
+
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
@@ -86,7 +101,7 @@ void            printfinit(void);
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
-int             growproc(int);
+int             growproc(int, uint64*);
 void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
@@ -112,6 +127,49 @@ int             update_procinfo(struct pinfo*);
 void		    print_sched_statistics(void);
 void		    set_sched_tickets(int);
 int             clone(void *);
+void            thread_exit(uint64);
+int             join(int, uint64, uint64);
+uint64          tstackgrow(pagetable_t, uint64);
+void            tstackfree(pagetable_t, int);
+int             set_sched_policy(int, int);
+int             set_sched_nice(int, int);
+int             set_sched_deadline(int, int, int);
+int             set_sched_gang(int);
+int             futexwait(uint64, int);
+int             futexwake(uint64, int);
+
+// sched.c
+void            runqinit(void);
+void            runqadd(struct proc*);
+struct proc*    runqtake(struct cpu*);
+struct proc*    runqsteal(struct cpu*);
+void            runqidle(struct cpu*);
+void            runqsetclass(struct proc*, struct schedclass*);
+struct schedclass* schedclass(int);
+struct schedclass* schedsetdefault(struct schedclass*);
+void            schedfork(struct proc*, struct proc*);
+void            schedexit(struct proc*);
+void            schedtick(struct proc*);
+int             schedresched(void);
+int             vbefore(uint64, uint64);
+void            heapinsert(struct procheap*, struct proc*);
+void            heapremove(struct procheap*, struct proc*);
+struct proc*    heappop(struct procheap*);
+void            groupinit(void);
+void            groupjoin(struct proc*, struct proc*);
+void            groupleave(struct proc*);
+void            groupsettickets(struct proc*, int);
+void            ganginit(void);
+void            gangjoin(struct mm*, struct proc*);
+void            gangleave(struct proc*);
+struct proc*    runqgang(struct cpu*);
+void            schedgang(struct proc*);
+
+// sched_edf.c
+int             edfadmit(struct proc*, uint64, uint64, uint64);
+
+// sched_mlfq.c
+int             mlfqsetquantum(int, int);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -147,12 +205,26 @@ int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
 
+// timer.c
+void            wheelinit(void);
+void            inittimer(struct timer*, void (*)(void*), void*);
+void            timeradd(struct timer*, int);
+int             timercancel(struct timer*);
+void            timeradvance(uint64);
+uint64          timeridle(void);
+int             sleepticks(int);
+
 // trap.c
 extern uint     ticks;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
+uint64          clockcycles(void);
+uint64          clockticks(void);
+void            clockset(uint64);
+void            clockintr(void);
+void            sendipi(int);
 
 // uart.c
 void            uartinit(void);
@@ -171,8 +243,10 @@ void            uvmfirst(pagetable_t, uchar *, uint);
 uint64          uvmalloc(pagetable_t, uint64, uint64, int);
 uint64          uvmdealloc(pagetable_t, uint64, uint64);
 int             uvmcopy(pagetable_t, pagetable_t, uint64);
+int             uvmcopysparse(pagetable_t, pagetable_t, uint64, uint64);
 void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
+void            uvmunmapsparse(pagetable_t, uint64, uint64);
 void            uvmclear(pagetable_t, uint64);
 pte_t *         walk(pagetable_t, uint64, int);
 uint64          walkaddr(pagetable_t, uint64);
@@ -28,7 +28,8 @@ exec(char *path, char **argv)
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
-  pagetable_t pagetable = 0, oldpagetable;
+  pagetable_t pagetable = 0;
+  struct mm *mm, *oldmm;
   struct proc *p = myproc();
 
   begin_op();
@@ -73,7 +74,6 @@ exec(char *path, char **argv)
   ip = 0;
 
   p = myproc();
-  uint64 oldsz = p->sz;
 
   // Allocate two pages at the next page boundary.
   // Make the first inaccessible as a stack guard.
@@ -119,14 +119,29 @@ exec(char *path, char **argv)
     if(*s == '/')
       last = s+1;
   safestrcpy(p->name, last, sizeof(p->name));
+
+  if((mm = mmalloc()) == 0)
+    goto bad;
     
-  // Commit to the user image.
-  oldpagetable = p->pagetable;
+  // Commit to the user image, in a new address space. The
+  // old one is freed once no other thread is using it.
+  oldmm = p->mm;
+  acquire(&oldmm->lock);
+  uvmunmap(oldmm->pagetable, TRAPFRAME - PGSIZE * p->tslot, 1, 0);
+  if(p->tslot)
+    tstackfree(oldmm->pagetable, p->tslot);
+  release(&oldmm->lock);
+  mm->pagetable = pagetable;
+  mm->sz = sz;
+  gangleave(p);
+  p->mm = mm;
+  gangjoin(mm, p);
   p->pagetable = pagetable;
-  p->sz = sz;
+  p->tslot = 0;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
-  proc_freepagetable(oldpagetable, oldsz);
+  p->trapframe->tp = 0;  // no thread-local storage yet
+  mmput(oldmm);
 
   return argc; // this ends up in a0, the first argument to main(argc, argv)
 
@@ -7,6 +7,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "riscv.h"
+#include "memstat.h"
 #include "defs.h"
 void freerange(void *pa_start, void *pa_end);
 
@@ -17,81 +18,305 @@ struct run {
   struct run *next;
 };
 
+// Each cpu keeps a magazine of free pages of its own, so
+// that most kalloc() and kfree() calls take only that cpu's
+// lock. A magazine that runs empty refills from the global
+// list KBATCH pages at a time, and one that grows past KMAG
+// pages drains KBATCH of them back to it. When the global
+// list is empty too, kalloc() steals half of another cpu's
+// magazine.
+//
+// The counts of free and used pages are kept as they change,
+// per cpu, so reading them never walks a list or takes a
+// lock. A page freed on another cpu than the one that
+// allocated it makes one cpu's used[] count negative, but
+// the sums are right. The watermarks are sampled whenever a
+// magazine refills or drains, so they can be off by up to
+// a magazine's worth of pages per cpu.
+//
+// Lock order: a magazine's lock, then kmem.lock.
+// No one holds two magazine locks at once.
+
+#define KBATCH 32   // pages moved to or from the global list at once
+#define KMAG   64   // most pages a magazine keeps
+#define NPAGE  ((PHYSTOP - KERNBASE) / PGSIZE)
+
+struct kmag {
+  struct spinlock lock;
+  struct run *freelist;
+  int n;            // pages on freelist
+  int used[NMEM];   // pages allocated here less pages freed here, by MEM_*
+};
+
 struct {
   struct spinlock lock;
   struct run *freelist;
+  int n;                  // pages on freelist
+  int total;              // pages freerange() added
+  int freelow;            // watermarks, under lock
+  int usedhigh[NMEM];
+  uchar kind[NPAGE];      // MEM_* of each allocated page
+  struct kmag mag[NCPU];
 } kmem;
 
 void
 kinit()
 {
+  int i;
+
   initlock(&kmem.lock, "kmem");
+  for(i = 0; i < NCPU; i++)
+    initlock(&kmem.mag[i].lock, "kmag");
   freerange(end, (void*)PHYSTOP);
+  kmem.freelow = kmem.total;
 }
 
+// Add the pages in [pa_start, pa_end) to the global list.
 void
 freerange(void *pa_start, void *pa_end)
 {
   char *p;
+  struct run *r;
+
   p = (char*)PGROUNDUP((uint64)pa_start);
-  for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE)
-    kfree(p);
+  acquire(&kmem.lock);
+  for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE){
+    memset(p, 1, PGSIZE);
+    r = (struct run*)p;
+    r->next = kmem.freelist;
+    kmem.freelist = r;
+    kmem.n++;
+    kmem.total++;
+  }
+  release(&kmem.lock);
+}
+
+// This cpu's magazine. The caller may move to another cpu
+// afterwards; that only costs it some locality, since each
+// magazine has its own lock.
+static struct kmag*
+mymag(void)
+{
+  int id;
+
+  push_off();
+  id = cpuid();
+  pop_off();
+  return &kmem.mag[id];
+}
+
+// Free pages, and pages in use of kind k; the other cpus'
+// counts are read without their locks.
+static int
+nfree(void)
+{
+  int i, n;
+
+  n = kmem.n;
+  for(i = 0; i < NCPU; i++)
+    n += kmem.mag[i].n;
+  return n;
+}
+
+static int
+nused(int k)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < NCPU; i++)
+    n += kmem.mag[i].used[k];
+  return n < 0 ? 0 : n;
+}
+
+// Update the watermarks. Caller must hold kmem.lock.
+static void
+kmemsample(void)
+{
+  int k, n;
+
+  if((n = nfree()) < kmem.freelow)
+    kmem.freelow = n;
+  for(k = 0; k < NMEM; k++)
+    if((n = nused(k)) > kmem.usedhigh[k])
+      kmem.usedhigh[k] = n;
+}
+
+// Move up to KBATCH pages from the global list to m.
+// Caller must hold m->lock.
+static void
+magrefill(struct kmag *m)
+{
+  struct run *r;
+  int i;
+
+  acquire(&kmem.lock);
+  for(i = 0; i < KBATCH && (r = kmem.freelist) != 0; i++){
+    kmem.freelist = r->next;
+    kmem.n--;
+    r->next = m->freelist;
+    m->freelist = r;
+    m->n++;
+  }
+  kmemsample();
+  release(&kmem.lock);
+}
+
+// Move KBATCH pages from m to the global list.
+// Caller must hold m->lock.
+static void
+magdrain(struct kmag *m)
+{
+  struct run *r;
+  int i;
+
+  acquire(&kmem.lock);
+  for(i = 0; i < KBATCH && (r = m->freelist) != 0; i++){
+    m->freelist = r->next;
+    m->n--;
+    r->next = kmem.freelist;
+    kmem.freelist = r;
+    kmem.n++;
+  }
+  kmemsample();
+  release(&kmem.lock);
+}
+
+// m and the global list are empty: take half of the
+// pages of the first other magazine that has any, keep
+// the rest in m, and return one of them, counted as
+// kind, or 0.
+// Caller must hold no magazine lock.
+static struct run*
+magsteal(struct kmag *m, int kind)
+{
+  struct kmag *o;
+  struct run *r, *list, *last;
+  int i, n;
+
+  for(o = kmem.mag; o < &kmem.mag[NCPU]; o++){
+    if(o == m || o->n == 0)
+      continue;
+    acquire(&o->lock);
+    n = (o->n + 1) / 2;
+    list = last = 0;
+    for(i = 0; i < n && (r = o->freelist) != 0; i++){
+      o->freelist = r->next;
+      o->n--;
+      r->next = list;
+      list = r;
+      if(last == 0)
+        last = r;
+    }
+    release(&o->lock);
+    if(list == 0)
+      continue;
+
+    r = list;
+    list = r->next;
+    acquire(&m->lock);
+    if(list){
+      last->next = m->freelist;
+      m->freelist = list;
+      m->n += i - 1;
+    }
+    m->used[kind]++;
+    release(&m->lock);
+    return r;
+  }
+  return 0;
 }
 
 // Free the page of physical memory pointed at by pa,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// which should have been returned by a call to kalloc()
+// or kallockind().
 void
 kfree(void *pa)
 {
   struct run *r;
+  struct kmag *m;
+  int kind;
 
   if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
     panic("kfree");
 
+  // the page is the caller's, so no lock is needed here.
+  kind = kmem.kind[((uint64)pa - KERNBASE) / PGSIZE];
+
   // Fill with junk to catch dangling refs.
   memset(pa, 1, PGSIZE);
 
   r = (struct run*)pa;
 
-  acquire(&kmem.lock);
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  release(&kmem.lock);
+  m = mymag();
+  acquire(&m->lock);
+  r->next = m->freelist;
+  m->freelist = r;
+  m->n++;
+  m->used[kind]--;
+  if(m->n > KMAG)
+    magdrain(m);
+  release(&m->lock);
 }
 
-// Allocate one 4096-byte page of physical memory.
+// Allocate one 4096-byte page of physical memory,
+// to be used for kind, one of MEM_* in memstat.h.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated.
 void *
-kalloc(void)
+kallockind(int kind)
 {
   struct run *r;
+  struct kmag *m;
 
-  acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  release(&kmem.lock);
+  m = mymag();
+  acquire(&m->lock);
+  if(m->freelist == 0)
+    magrefill(m);
+  r = m->freelist;
+  if(r){
+    m->freelist = r->next;
+    m->n--;
+    m->used[kind]++;
+  }
+  release(&m->lock);
+  if(r == 0)
+    r = magsteal(m, kind);
 
-  if(r)
+  if(r){
+    kmem.kind[((uint64)r - KERNBASE) / PGSIZE] = kind;
     memset((char*)r, 5, PGSIZE); // fill with junk
+  }
   return (void*)r;
 }
 
+void *
+kalloc(void)
+{
+  return kallockind(MEM_OTHER);
+}
+
 //lab1 1-2
 int 
 get_freePages(void)
 {
-  int count = 0;
-  struct run *r;
+  return nfree();
+}
+
+// Fill in st.
+void
+kmemstat(struct memstat *st)
+{
+  int k;
+
   acquire(&kmem.lock);
-  r = kmem.freelist;
-  while (r) {
-    ++count;
-    r = r->next;
+  kmemsample();
+  st->total = kmem.total;
+  st->free = nfree();
+  st->freelow = kmem.freelow;
+  for(k = 0; k < NMEM; k++){
+    st->used[k] = nused(k);
+    st->usedhigh[k] = kmem.usedhigh[k];
   }
   release(&kmem.lock);
-  return count;
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 #include "param.h"
 #include "memlayout.h"
 #include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
 #include "defs.h"
 
 volatile static int started = 0;
@@ -20,7 +22,9 @@ main()
     kvminit();       // create kernel page table
     kvminithart();   // turn on paging
     procinit();      // process table
+    mminit();        // address spaces
     trapinit();      // trap vectors
+    wheelinit();     // timeouts
     trapinithart();  // install kernel trap vector
     plicinit();      // set up interrupt controller
     plicinithart();  // ask PLIC for device interrupts
@@ -41,5 +45,7 @@ main()
     plicinithart();   // ask PLIC for device interrupts
   }
 
+  mycpu()->started = 1;
+  __sync_synchronize();
   scheduler();        
 }
@@ -27,6 +27,7 @@
 
 // core local interruptor (CLINT), which contains the timer.
 #define CLINT 0x2000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid))
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
 
@@ -60,8 +61,19 @@
 //   text
 //   original data and bss
 //   fixed-size stack
-//   expandable heap
+//   expandable heap, up to USERTOP
 //   ...
+//   thread stacks
+//   thread trapframes
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+
+// the thread in trapframe slot n keeps its trapframe at
+// TRAPFRAME - n*PGSIZE, for n from 1 to NPROC-1, and its
+// stack below TSTACK(n). the stack starts out unmapped and
+// grows a page at a time as the thread faults on it, to at
+// most TSTACKPAGES pages, above an unmapped guard page.
+#define TSTACKTOP (TRAPFRAME - NPROC*PGSIZE)
+#define TSTACK(n) (TSTACKTOP - ((n)-1)*(TSTACKPAGES+1)*PGSIZE)
+#define USERTOP TSTACK(NPROC)
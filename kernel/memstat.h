@@ -0,0 +1,18 @@
+// Physical memory statistics, for memstat().
+
+// What an allocated page is used for.
+#define MEM_PAGETABLE  0  // page-table pages
+#define MEM_KSTACK     1  // kernel stacks
+#define MEM_PIPE       2  // pipe buffers
+#define MEM_TRAPFRAME  3  // trapframes
+#define MEM_USER       4  // user memory
+#define MEM_OTHER      5  // anything else, from kalloc()
+#define NMEM           6
+
+struct memstat {
+  uint64 total;           // pages the allocator manages
+  uint64 free;            // free pages
+  uint64 freelow;         // low watermark of free pages
+  uint64 used[NMEM];      // pages in use, by MEM_*
+  uint64 usedhigh[NMEM];  // high watermark of used[]
+};
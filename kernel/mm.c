@@ -0,0 +1,192 @@
+//
+// Address spaces. A process and the threads it clone()s
+// share one struct mm, so that when any of them grows or
+// shrinks its memory the others see the new size. The page
+// table is freed when the last proc using it lets go.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "memstat.h"
+#include "defs.h"
+
+struct {
+  struct spinlock lock;  // protects ref in every mm
+  struct mm mm[NPROC];
+} mmtable;
+
+void
+mminit(void)
+{
+  struct mm *mm;
+
+  initlock(&mmtable.lock, "mmtable");
+  for(mm = mmtable.mm; mm < mmtable.mm + NPROC; mm++)
+    initlock(&mm->lock, "mm");
+}
+
+// Allocate an empty address space with one reference.
+struct mm*
+mmalloc(void)
+{
+  struct mm *mm;
+
+  acquire(&mmtable.lock);
+  for(mm = mmtable.mm; mm < mmtable.mm + NPROC; mm++){
+    if(mm->ref == 0){
+      mm->ref = 1;
+      mm->pagetable = 0;
+      mm->sz = 0;
+      mm->stackslot = 0;
+      mm->gang = 0;
+      mm->members = 0;
+      mm->growing = 0;
+      release(&mmtable.lock);
+      return mm;
+    }
+  }
+  release(&mmtable.lock);
+  return 0;
+}
+
+// Add a reference, for a new thread.
+struct mm*
+mmdup(struct mm *mm)
+{
+  acquire(&mmtable.lock);
+  if(mm->ref < 1)
+    panic("mmdup");
+  mm->ref++;
+  release(&mmtable.lock);
+  return mm;
+}
+
+// Drop a reference. The last one frees the user memory and
+// the page table. Each proc must already have unmapped its
+// own trapframe page and thread stack.
+void
+mmput(struct mm *mm)
+{
+  pagetable_t pagetable;
+  uint64 sz;
+  int stackslot;
+
+  acquire(&mmtable.lock);
+  if(mm->ref < 1)
+    panic("mmput");
+  if(--mm->ref > 0){
+    release(&mmtable.lock);
+    return;
+  }
+  pagetable = mm->pagetable;
+  sz = mm->sz;
+  stackslot = mm->stackslot;
+  mm->pagetable = 0;
+  mm->sz = 0;
+  release(&mmtable.lock);
+
+  if(pagetable){
+    if(stackslot)
+      tstackfree(pagetable, stackslot);
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmfree(pagetable, sz);
+  }
+}
+
+// Make every other cpu that is running a thread of mm flush
+// its TLB, and wait until they all have, so that pages mm no
+// longer maps can be freed. Caller must hold no spinlock, so
+// that this cpu takes interrupts, and so flushes for others,
+// while it waits.
+static void
+mmshootdown(struct mm *mm)
+{
+  struct cpu *c;
+  struct proc *q;
+  int n;
+
+  // the cleared PTEs must be visible before anyone flushes.
+  __sync_synchronize();
+  n = 0;
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    // c->proc is read without a lock. A cpu that starts
+    // running a thread of mm after this flushes its TLB
+    // when it switches to mm's page table anyway.
+    q = c->proc;
+    if(q == 0 || q == myproc() || q->mm != mm)
+      continue;
+    c->tlbflush = 1;
+    __sync_synchronize();
+    sendipi(c - cpus);
+    n++;
+  }
+  if(n == 0)
+    return;
+  for(c = cpus; c < &cpus[NCPU]; c++)
+    while(c->tlbflush)
+      ;
+}
+
+// Map zeroed user pages for [oldsz, newsz), one page at a
+// time, so that mm->lock is held only briefly. The caller
+// updates mm->sz. Returns 0, or -1 after unmapping whatever
+// it mapped.
+int
+mmgrow(struct mm *mm, uint64 oldsz, uint64 newsz)
+{
+  char *mem;
+  uint64 a;
+
+  for(a = PGROUNDUP(oldsz); a < newsz; a += PGSIZE){
+    if((mem = kallockind(MEM_USER)) == 0)
+      goto err;
+    memset(mem, 0, PGSIZE);
+    acquire(&mm->lock);
+    if(mappages(mm->pagetable, a, PGSIZE, (uint64)mem, PTE_R|PTE_U|PTE_W) != 0){
+      release(&mm->lock);
+      kfree(mem);
+      goto err;
+    }
+    release(&mm->lock);
+  }
+  return 0;
+
+ err:
+  mmshrink(mm, a, oldsz);
+  return -1;
+}
+
+#define NSHRINK 32  // pages mmshrink() unmaps per TLB shootdown
+
+// Unmap and free the user pages in [newsz, oldsz). Other
+// threads of mm may still have them in their TLBs, so each
+// batch is freed only after mmshootdown(). The caller has
+// already lowered mm->sz.
+void
+mmshrink(struct mm *mm, uint64 oldsz, uint64 newsz)
+{
+  uint64 a, end, pa[NSHRINK];
+  pte_t *pte;
+  int i, n;
+
+  a = PGROUNDUP(newsz);
+  end = PGROUNDUP(oldsz);
+  while(a < end){
+    n = 0;
+    acquire(&mm->lock);
+    for(; a < end && n < NSHRINK; a += PGSIZE){
+      if((pte = walk(mm->pagetable, a, 0)) == 0 || (*pte & PTE_V) == 0)
+        continue;
+      pa[n++] = PTE2PA(*pte);
+      *pte = 0;
+    }
+    release(&mm->lock);
+    mmshootdown(mm);
+    for(i = 0; i < n; i++)
+      kfree((void*)pa[i]);
+  }
+}
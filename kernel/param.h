@@ -1,4 +1,4 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       256  // maximum number of processes
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
@@ -11,3 +11,10 @@
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       2000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
+#define TICKCYCLES 1000000 // timer cycles per clock tick; about 1/10th second in qemu
+#define MAXTICKETS 10000   // default and largest ticket count
+#define STRIDE1   (1<<20)  // stride of a process holding one ticket
+#define NMLFQ         3    // MLFQ priority levels
+#define MLFQBOOST    50    // ticks between MLFQ priority boosts
+#define TSTACKPAGES  64    // most pages a thread's stack grows to
+#define GANGSLICE     5    // ticks the threads of a gang run together
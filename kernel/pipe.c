@@ -7,6 +7,7 @@
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "memstat.h"
 
 #define PIPESIZE 512
 
@@ -28,7 +29,7 @@ pipealloc(struct file **f0, struct file **f1)
   *f0 = *f1 = 0;
   if((*f0 = filealloc()) == 0 || (*f1 = filealloc()) == 0)
     goto bad;
-  if((pi = (struct pipe*)kalloc()) == 0)
+  if((pi = (struct pipe*)kallockind(MEM_PIPE)) == 0)
     goto bad;
   pi->readopen = 1;
   pi->writeopen = 1;
@@ -4,6 +4,8 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "sched.h"
+#include "memstat.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
@@ -15,13 +17,17 @@ struct proc *initproc;
 int nextpid = 1;
 int nexttid = 1;
 struct spinlock pid_lock;
+
+// tid_lock protects nexttid and the choice of trapframe
+// slots, so that two clones of one address space cannot
+// pick the same slot.
 struct spinlock tid_lock;
 int syscall_counter = 0;
-int stride1 = 10000;
 
 extern void forkret(void);
 extern int get_freePages();
 static void freeproc(struct proc *p);
+static int stackslot(struct proc *p);
 
 extern char trampoline[]; // trampoline.S
 
@@ -31,6 +37,24 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
+// Sleeping processes, hashed by wait channel, so that
+// wakeup() looks only at the processes sleeping on
+// channels in the same bucket.
+// A bucket's lock must be acquired before any p->lock.
+#define NCHANHASH 64
+struct {
+	struct spinlock lock;
+	struct proc *head;
+} chantab[NCHANHASH];
+
+	static int
+chanhash(void *chan)
+{
+	// channels are addresses of kernel objects; drop the low
+	// bits that alignment makes mostly zero, then mix.
+	return (((uint64)chan >> 3) * 0x9E3779B97F4A7C15ull) >> 58;
+}
+
 // Allocate a page for each process's kernel stack.
 // Map it high in memory, followed by an invalid
 // guard page.
@@ -40,7 +64,7 @@ proc_mapstacks(pagetable_t kpgtbl)
 	struct proc *p;
 
 	for(p = proc; p < &proc[NPROC]; p++) {
-		char *pa = kalloc();
+		char *pa = kallockind(MEM_KSTACK);
 		if(pa == 0)
 			panic("kalloc");
 		uint64 va = KSTACK((int) (p - proc));
@@ -56,6 +80,11 @@ procinit(void)
 	initlock(&pid_lock, "nextpid");
 	initlock(&wait_lock, "wait_lock");
 	initlock(&tid_lock, "nexttid");
+	for(int i = 0; i < NCHANHASH; i++)
+		initlock(&chantab[i].lock, "chantab");
+	runqinit();
+	groupinit();
+	ganginit();
 	for(p = proc; p < &proc[NPROC]; p++) {
 		initlock(&p->lock, "proc");
 		p->state = UNUSED;
@@ -119,6 +148,32 @@ alloctid()
 	return tid;
 }
 
+// Find the lowest trapframe slot not used by any thread of
+// the address space mm. Thread slot n keeps its
+// trapframe at TRAPFRAME - n*PGSIZE; slot 0 is the process's
+// own TRAPFRAME page. A slot is free again once freeproc()
+// has unmapped it, so a long-lived process can create any
+// number of threads over time, and as many at once as there
+// are procs. The slot of a stack fork() copied in from a
+// thread stays taken. tid_lock must be held.
+	static int
+allocslot(struct mm *mm)
+{
+	char used[NPROC];
+	struct proc *q;
+	int slot;
+
+	memset(used, 0, sizeof(used));
+	used[mm->stackslot] = 1;
+	for(q = proc; q < &proc[NPROC]; q++)
+		if(q->mm == mm && q->tslot < NPROC)
+			used[q->tslot] = 1;
+	for(slot = 1; slot < NPROC; slot++)
+		if(!used[slot])
+			return slot;
+	return -1;
+}
+
 // Look in the process table for an UNUSED proc.
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
@@ -141,28 +196,42 @@ allocproc(int isthread)
 found:
 	p->pid = allocpid();
 	p->state = USED;
-	p->tickets = stride1;
+	p->tickets = MAXTICKETS;
+	p->etickets = MAXTICKETS;
+	p->sgroup = 0;
 	p->ticks = 0;
-	p->stride = 10;
+	p->stride = STRIDE1 / MAXTICKETS;
 	p->pass = 0;
+	p->nice = 0;
+	p->vruntime = 0;
+	p->runtime = 0;
+	p->throttled = 0;
+	p->dlmissed = 0;
+	p->mlfqlevel = 0;
+	p->mlfqused = 0;
+	p->mlfqepoch = 0;
+	schedfork(0, p);
+	p->tslot = 0;
 	if(!isthread)
 		p->tid = 0;
 	else
 		p->tid = alloctid();
-	if((p->trapframe = (struct trapframe *)kalloc()) == 0){
+	if((p->trapframe = (struct trapframe *)kallockind(MEM_TRAPFRAME)) == 0){
 		freeproc(p);
 		release(&p->lock);
 		return 0;
 	}
 
 	if (!isthread) {
-		// An empty user page table.
-		p->pagetable = proc_pagetable(p);
-		if(p->pagetable == 0){
+		// An empty address space.
+		if((p->mm = mmalloc()) == 0 ||
+				(p->mm->pagetable = proc_pagetable(p)) == 0){
 			freeproc(p);
 			release(&p->lock);
 			return 0;
 		}
+		p->pagetable = p->mm->pagetable;
+		gangjoin(p->mm, p);
 	}
 	// Set up new context to start executing at forkret,
 	// which returns to user space.
@@ -182,14 +251,18 @@ freeproc(struct proc *p)
 	if(p->trapframe)
 		kfree((void*)p->trapframe);
 	p->trapframe = 0;
-	if(p->pagetable) {
-		if(p->tid)
-			uvmunmap(p->pagetable, TRAPFRAME - PGSIZE * (p->tid), 1, 0);
-		else
-			proc_freepagetable(p->pagetable, p->sz);
+	if(p->mm) {
+		acquire(&p->mm->lock);
+		if(p->pagetable)
+			uvmunmap(p->pagetable, TRAPFRAME - PGSIZE * p->tslot, 1, 0);
+		if(p->tslot)
+			tstackfree(p->pagetable, p->tslot);
+		release(&p->mm->lock);
+		gangleave(p);
+		mmput(p->mm);
 	}
+	p->mm = 0;
 	p->pagetable = 0;
-	p->sz = 0;
 	p->pid = 0;
 	p->parent = 0;
 	p->name[0] = 0;
@@ -198,6 +271,10 @@ freeproc(struct proc *p)
 	p->xstate = 0;
 	p->state = UNUSED;
 	p->tid = 0;
+	p->tslot = 0;
+	p->ustack = 0;
+	p->retval = 0;
+	p->cpu = 0;
 }
 
 // Create a user page table for a given process, with no user memory,
@@ -269,7 +346,7 @@ userinit(void)
 	// allocate one user page and copy initcode's instructions
 	// and data into it.
 	uvmfirst(p->pagetable, initcode, sizeof(initcode));
-	p->sz = PGSIZE;
+	p->mm->sz = PGSIZE;
 
 	// prepare for the very first "return" from kernel to user.
 	p->trapframe->epc = 0;      // user program counter
@@ -279,28 +356,54 @@ userinit(void)
 	p->cwd = namei("/");
 
 	p->state = RUNNABLE;
+	runqadd(p);
 
 	release(&p->lock);
 }
 
-// Grow or shrink user memory by n bytes.
+// Grow or shrink user memory by n bytes, for every thread
+// sharing it, and store the old size in *oldsz.
 // Return 0 on success, -1 on failure.
+// One growproc() at a time runs per address space, marked by
+// mm->growing, so that mm->lock, a spinlock, need not be held
+// across the whole change; mmgrow() and mmshrink() hold it
+// a page or a batch of pages at a time. Sleeping with mm->lock
+// held is safe because whoever holds a p->lock while taking
+// mm->lock (freeproc(), fork()) holds that of a proc that is
+// not running, never the sleeper's.
 	int
-growproc(int n)
+growproc(int n, uint64 *oldsz)
 {
 	uint64 sz;
-	struct proc *p = myproc();
+	struct mm *mm = myproc()->mm;
+	int r = 0;
+
+	acquire(&mm->lock);
+	while(mm->growing)
+		sleep(&mm->growing, &mm->lock);
+	mm->growing = 1;
+	sz = *oldsz = mm->sz;
+	if(n < 0 && (uint64)-n > sz)
+		n = -(int)sz;
+	// a shrink takes effect at once; the pages go after.
+	if(n < 0)
+		mm->sz = sz + n;
+	release(&mm->lock);
 
-	sz = p->sz;
 	if(n > 0){
-		if((sz = uvmalloc(p->pagetable, sz, sz + n, PTE_W)) == 0) {
-			return -1;
-		}
+		if(sz + n > USERTOP || mmgrow(mm, sz, sz + n) < 0)
+			r = -1;
 	} else if(n < 0){
-		sz = uvmdealloc(p->pagetable, sz, sz + n);
+		mmshrink(mm, sz, sz + n);
 	}
-	p->sz = sz;
-	return 0;
+
+	acquire(&mm->lock);
+	if(n > 0 && r == 0)
+		mm->sz = sz + n;
+	mm->growing = 0;
+	wakeup(&mm->growing);
+	release(&mm->lock);
+	return r;
 }
 
 // Create a new process, copying the parent.
@@ -316,13 +419,29 @@ fork(void)
 		return -1;
 	}
 
-	// Copy user memory from parent to child.
-	if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
+	// Copy user memory from parent to child, keeping the
+	// parent's threads from resizing it meanwhile.
+	acquire(&p->mm->lock);
+	if(uvmcopy(p->pagetable, np->pagetable, p->mm->sz) < 0){
+		release(&p->mm->lock);
 		freeproc(np);
 		release(&np->lock);
 		return -1;
 	}
-	np->sz = p->sz;
+	np->mm->sz = p->mm->sz;
+
+	// A thread's stack lies above sz. Give the child a copy
+	// in the same place, which it may go on growing.
+	np->mm->stackslot = stackslot(p);
+	if(np->mm->stackslot && uvmcopysparse(p->pagetable, np->pagetable,
+				TSTACK(np->mm->stackslot) - TSTACKPAGES*PGSIZE, TSTACKPAGES) < 0){
+		np->mm->stackslot = 0;
+		release(&p->mm->lock);
+		freeproc(np);
+		release(&np->lock);
+		return -1;
+	}
+	release(&p->mm->lock);
 
 	// copy saved user registers.
 	*(np->trapframe) = *(p->trapframe);
@@ -347,7 +466,9 @@ fork(void)
 	release(&wait_lock);
 
 	acquire(&np->lock);
+	schedfork(p, np);
 	np->state = RUNNABLE;
+	runqadd(np);
 	release(&np->lock);
 
 	return pid;
@@ -379,6 +500,8 @@ exit(int status)
 	if(p == initproc)
 		panic("init exiting");
 
+	groupleave(p);
+
 	// Close all open files.
 	for(int fd = 0; fd < NOFILE; fd++){
 		if(p->ofile[fd]){
@@ -405,6 +528,7 @@ exit(int status)
 
 	p->xstate = status;
 	p->state = ZOMBIE;
+	schedexit(p);
 
 	release(&wait_lock);
 
@@ -413,8 +537,116 @@ exit(int status)
 	panic("zombie exit");
 }
 
+// The slot whose thread stack p runs on: its own, or, for a
+// process forked from a thread, the one it was copied from.
+	static int
+stackslot(struct proc *p)
+{
+	return p->tslot ? p->tslot : p->mm->stackslot;
+}
+
+// Map a zeroed page at va if it lies in the calling thread's
+// stack, which pagetable must belong to. Called on a page
+// fault, and when a system call copies to or from a part of
+// the stack the thread has not touched yet. Return the page's
+// physical address, or 0 if va is not in the stack, which
+// includes the guard page below it.
+	uint64
+tstackgrow(pagetable_t pagetable, uint64 va)
+{
+	struct proc *p = myproc();
+	char *mem;
+	int slot;
+
+	va = PGROUNDDOWN(va);
+	if(p == 0 || (slot = stackslot(p)) == 0 || pagetable != p->pagetable ||
+			va >= TSTACK(slot) || va < TSTACK(slot) - TSTACKPAGES*PGSIZE)
+		return 0;
+	if((mem = kallockind(MEM_USER)) == 0)
+		return 0;
+	memset(mem, 0, PGSIZE);
+	acquire(&p->mm->lock);
+	if(mappages(pagetable, va, PGSIZE, (uint64)mem, PTE_R | PTE_W | PTE_U) != 0){
+		release(&p->mm->lock);
+		kfree(mem);
+		return 0;
+	}
+	release(&p->mm->lock);
+	return (uint64)mem;
+}
+
+// Free the stack pages of the thread in slot. The address
+// space's lock must be held.
+	void
+tstackfree(pagetable_t pagetable, int slot)
+{
+	uvmunmapsparse(pagetable, TSTACK(slot) - TSTACKPAGES*PGSIZE, TSTACKPAGES);
+}
+
+// Exit the current thread, leaving retval for join().
+	void
+thread_exit(uint64 retval)
+{
+	myproc()->retval = retval;
+	exit(0);
+}
+
+// Wait for thread tid, which the caller created with clone(),
+// to exit. Copy the value it passed to thread_exit() to
+// address retval and the stack it was given to address stack,
+// so the caller can free it, and release the thread's proc
+// right away. Return tid, or -1 if the caller has no such
+// thread.
+	int
+join(int tid, uint64 retval, uint64 stack)
+{
+	struct proc *pp;
+	int found;
+	struct proc *p = myproc();
+
+	acquire(&wait_lock);
+
+	for(;;){
+		found = 0;
+		for(pp = proc; pp < &proc[NPROC]; pp++){
+			if(pp->parent == p && pp->tid == tid && tid != 0){
+				// make sure the thread isn't still in exit() or swtch().
+				acquire(&pp->lock);
+
+				found = 1;
+				if(pp->state == ZOMBIE){
+					if((retval != 0 && copyout(p->pagetable, retval, (char *)&pp->retval,
+									sizeof(pp->retval)) < 0) ||
+							(stack != 0 && copyout(p->pagetable, stack, (char *)&pp->ustack,
+										sizeof(pp->ustack)) < 0)) {
+						release(&pp->lock);
+						release(&wait_lock);
+						return -1;
+					}
+					freeproc(pp);
+					release(&pp->lock);
+					release(&wait_lock);
+					return tid;
+				}
+				release(&pp->lock);
+				break;
+			}
+		}
+
+		if(!found || killed(p)){
+			release(&wait_lock);
+			return -1;
+		}
+
+		// Wait for the thread to exit.
+		sleep(p, &wait_lock);
+	}
+}
+
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
+// Threads sharing its address space are not children
+// here; join() reaps them.
 	int
 wait(uint64 addr)
 {
@@ -432,6 +664,12 @@ wait(uint64 addr)
 				// make sure the child isn't still in exit() or swtch().
 				acquire(&pp->lock);
 
+				// threads sharing p's address space are for join().
+				if(pp->mm == p->mm){
+					release(&pp->lock);
+					continue;
+				}
+
 				havekids = 1;
 				if(pp->state == ZOMBIE){
 					// Found one.
@@ -462,15 +700,6 @@ wait(uint64 addr)
 	}
 }
 
-unsigned short lfsr = 0xACE1u;
-unsigned short bit;
-
-unsigned short rand()
-{
-	bit = ((lfsr >> 0) ^ (lfsr >> 2) ^ (lfsr >> 3) ^ (lfsr >> 5)) & 1;
-	return lfsr = (lfsr >> 1) | (bit << 15);
-}
-
 
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
@@ -484,75 +713,60 @@ scheduler(void)
 {
 	struct proc *p;
 	struct cpu *c = mycpu();
+	uint64 start, ran;
 
 	c->proc = 0;
 	for(;;){
 		// Avoid deadlock by ensuring that devices can interrupt.
 		intr_on();
 
-#if defined(LOTTERY)
-		int sum_tickets = 0;
-		for (p = proc; p < &proc[NPROC]; p++)
-			if (p->state == RUNNABLE)
-				sum_tickets += p->tickets;
-		int lottery = rand() % sum_tickets;
-		int tickets_pointer = 0;
-		for (p = proc; p < &proc[NPROC]; p++)
-		{
-			acquire(&p->lock);
-			if (p->state == RUNNABLE) {
-				tickets_pointer += p->tickets;
-				if (tickets_pointer > lottery) {
-					p->state = RUNNING;
-					p->ticks++;
-					c->proc = p;
-					swtch(&c->context, &p->context);
-					c->proc = 0;
-					release(&p->lock);
-					break;
-				}
-			}
-			release(&p->lock);
+		// Take a process from this cpu's run queue,
+		// or steal one from a busier cpu.
+		// Members of the running gang, if any, come first.
+		if((p = runqgang(c)) == 0 && (p = runqtake(c)) == 0 &&
+		   (p = runqsteal(c)) == 0){
+			runqidle(c);
+			continue;
 		}
-#elif defined(STRIDE)
-		int min_pass = __INT_MAX__;
-		struct proc *last_proc =  0;
-		for (p = proc; p < &proc[NPROC]; p++) 
-			if (p->state == RUNNABLE) {
-				if (min_pass > p->pass) {
-					min_pass = p->pass;
-					last_proc = p;
-				}
+
+		acquire(&p->lock);
+		if(p->state == RUNNABLE) {
+			// Switch to chosen process.  It is the process's job
+			// to release its lock and then reacquire it
+			// before jumping back to us.
+			p->state = RUNNING;
+			p->cpu = c;
+			p->ticks++;
+			schedgang(p);
+			c->proc = p;
+			if(p->waketime){
+				// account for wake-to-run latency.
+				uint64 wait = clockcycles() - p->waketime;
+				c->nwakeups++;
+				c->wakecycles += wait;
+				if(wait > c->maxwakecycles)
+					c->maxwakecycles = wait;
+				p->waketime = 0;
 			}
-		if (last_proc != 0) {
-			acquire(&last_proc->lock);
-			last_proc->state = RUNNING;
-			last_proc->pass += last_proc->stride;
-			++(last_proc->ticks);
-			c->proc = last_proc;
-			swtch(&c->context, &last_proc->context);
+			clockset(clockticks() + 1);
+			c->resched = 0;
+			start = clockcycles();
+			swtch(&c->context, &p->context);
+
+			// Process is done running for now.
+			// It should have changed its p->state before coming back.
 			c->proc = 0;
-			release(&last_proc->lock);
-		}
 
-#else
-		for(p = proc; p < &proc[NPROC]; p++) {
-			acquire(&p->lock);
-			if(p->state == RUNNABLE) {
-				// Switch to chosen process.  It is the process's job
-				// to release its lock and then reacquire it
-				// before jumping back to us.
-				p->state = RUNNING;
-				c->proc = p;
-				swtch(&c->context, &p->context);
-
-				// Process is done running for now.
-				// It should have changed its p->state before coming back.
-				c->proc = 0;
-			}
-			release(&p->lock);
+			// charge p for the cycles it ran, then, if it
+			// only gave up the cpu, queue it to run again.
+			ran = clockcycles() - start;
+			p->runtime += ran;
+			if(p->sclass->charge)
+				p->sclass->charge(p, ran);
+			if(p->state == RUNNABLE)
+				runqadd(p);
 		}
-#endif
+		release(&p->lock);
 	}
 }
 
@@ -621,20 +835,26 @@ forkret(void)
 sleep(void *chan, struct spinlock *lk)
 {
 	struct proc *p = myproc();
+	int h = chanhash(chan);
 
 	// Must acquire p->lock in order to
 	// change p->state and then call sched.
-	// Once we hold p->lock, we can be
+	// Once p is in chan's bucket, we can be
 	// guaranteed that we won't miss any wakeup
-	// (wakeup locks p->lock),
+	// (wakeup locks the bucket, then p->lock),
 	// so it's okay to release lk.
 
+	acquire(&chantab[h].lock);
 	acquire(&p->lock);  //DOC: sleeplock1
-	release(lk);
 
 	// Go to sleep.
 	p->chan = chan;
 	p->state = SLEEPING;
+	p->chnext = chantab[h].head;
+	chantab[h].head = p;
+
+	release(&chantab[h].lock);
+	release(lk);
 
 	sched();
 
@@ -651,17 +871,139 @@ sleep(void *chan, struct spinlock *lk)
 	void
 wakeup(void *chan)
 {
-	struct proc *p;
-
-	for(p = proc; p < &proc[NPROC]; p++) {
-		if(p != myproc()){
-			acquire(&p->lock);
-			if(p->state == SLEEPING && p->chan == chan) {
-				p->state = RUNNABLE;
-			}
-			release(&p->lock);
+	struct proc *p, **pp;
+	int h = chanhash(chan);
+
+	acquire(&chantab[h].lock);
+	pp = &chantab[h].head;
+	while((p = *pp) != 0){
+		if(p->chan != chan){
+			pp = &p->chnext;
+			continue;
 		}
+		// p may still be on its way into sched();
+		// acquiring p->lock waits until it is off its cpu.
+		acquire(&p->lock);
+		*pp = p->chnext;
+		p->chnext = 0;
+		p->state = RUNNABLE;
+		p->waketime = clockcycles();
+		runqadd(p);
+		release(&p->lock);
 	}
+	release(&chantab[h].lock);
+}
+
+// Wake p if it is still asleep on chan.
+// Must be called without any p->lock.
+	static void
+wakeproc(struct proc *p, void *chan)
+{
+	struct proc **pp;
+	int h = chanhash(chan);
+
+	acquire(&chantab[h].lock);
+	acquire(&p->lock);
+	if(p->state == SLEEPING && p->chan == chan){
+		for(pp = &chantab[h].head; *pp != p; pp = &(*pp)->chnext)
+			;
+		*pp = p->chnext;
+		p->chnext = 0;
+		p->state = RUNNABLE;
+		p->waketime = clockcycles();
+		runqadd(p);
+	}
+	release(&p->lock);
+	release(&chantab[h].lock);
+}
+
+// Find the physical address of the int at user address va,
+// which futexes are keyed on, so that threads sharing a page
+// table, or processes sharing a page, meet at the same key.
+// Returns 0 if va is not a mapped, aligned user address.
+	static uint64
+futexkey(uint64 va)
+{
+	uint64 pa;
+
+	if(va % sizeof(int) != 0)
+		return 0;
+	if((pa = walkaddr(myproc()->pagetable, va)) == 0)
+		return 0;
+	return pa + (va & (PGSIZE-1));
+}
+
+// Sleep until futexwake(), if the int at user address va
+// still holds val. The check and the sleep are atomic with
+// respect to futexwake(), as both hold the key's bucket lock.
+// Returns 0 when woken, or -1 if the value differed, va was
+// bad, or the caller has been killed.
+	int
+futexwait(uint64 va, int val)
+{
+	struct proc *p = myproc();
+	uint64 pa;
+	int h;
+
+	if((pa = futexkey(va)) == 0)
+		return -1;
+	h = chanhash((void*)pa);
+
+	acquire(&chantab[h].lock);
+	// the kernel maps all of RAM at its physical address.
+	if(*(int*)pa != val || killed(p)){
+		release(&chantab[h].lock);
+		return -1;
+	}
+	acquire(&p->lock);
+	p->chan = (void*)pa;
+	p->state = SLEEPING;
+	p->chnext = chantab[h].head;
+	chantab[h].head = p;
+	release(&chantab[h].lock);
+
+	sched();
+
+	p->chan = 0;
+	release(&p->lock);
+	return 0;
+}
+
+// Wake up to n processes waiting in futexwait() on the int
+// at user address va, longest waiting first.
+// Returns the number woken, or -1 if va was bad.
+	int
+futexwake(uint64 va, int n)
+{
+	struct proc *p, **pp, **oldest;
+	uint64 pa;
+	int h, woken;
+
+	if((pa = futexkey(va)) == 0)
+		return -1;
+	h = chanhash((void*)pa);
+
+	acquire(&chantab[h].lock);
+	for(woken = 0; woken < n; woken++){
+		// sleep() pushes onto the bucket's head, so the
+		// longest waiting is the last match.
+		oldest = 0;
+		for(pp = &chantab[h].head; *pp; pp = &(*pp)->chnext)
+			if((*pp)->chan == (void*)pa)
+				oldest = pp;
+		if(oldest == 0)
+			break;
+		p = *oldest;
+		acquire(&p->lock);
+		*oldest = p->chnext;
+		p->chnext = 0;
+		p->state = RUNNABLE;
+		p->waketime = clockcycles();
+		runqadd(p);
+		release(&p->lock);
+	}
+	release(&chantab[h].lock);
+	return woken;
 }
 
 // Kill the process with the given pid.
@@ -671,16 +1013,18 @@ wakeup(void *chan)
 kill(int pid)
 {
 	struct proc *p;
+	void *chan;
 
 	for(p = proc; p < &proc[NPROC]; p++){
 		acquire(&p->lock);
 		if(p->pid == pid){
 			p->killed = 1;
-			if(p->state == SLEEPING){
-				// Wake process from sleep().
-				p->state = RUNNABLE;
-			}
+			chan = p->state == SLEEPING ? p->chan : 0;
 			release(&p->lock);
+			// Wake process from sleep(). The bucket lock
+			// comes before p->lock, so let go and retake it.
+			if(chan)
+				wakeproc(p, chan);
 			return 0;
 		}
 		release(&p->lock);
@@ -807,7 +1151,7 @@ update_procinfo(struct pinfo* in){
 	// assigning the fields of out with info
 	out.ppid = curproc->parent->pid;
 	out.syscall_count = curproc->syscall_count; 
-	out.page_usage = (PGROUNDUP(curproc->sz)) / PGSIZE;
+	out.page_usage = (PGROUNDUP(curproc->mm->sz)) / PGSIZE;
 
 	// if fail to copy results back, return -1
 	if (copyout(curproc->pagetable, (uint64)in, (char *)&out, sizeof(out)) < 0) return -1;
@@ -819,10 +1163,38 @@ update_procinfo(struct pinfo* in){
 print_sched_statistics(void)
 {
 	struct proc *p;
+	struct cpu *c;
+	uint64 n = 0, total = 0, max = 0;
+	int nlevel[NMLFQ] = { 0 }, nmlfq = 0, i;
+	uint64 demoted;
+
 	for (p = proc; p < &proc[NPROC]; p++) {
 		if (p->state != UNUSED)
 			printf("%d(%s): tickets: %d, ticks: %d\n", p->pid, p->name, p->tickets, p->ticks);
+		if (p->state != UNUSED && p->sclass->rt)
+			printf("%d(%s): edf: runtime %d, period %d, deadline %d ticks, missed %d\n",
+			       p->pid, p->name, (int)(p->dlruntime / TICKCYCLES),
+			       (int)(p->dlperiod / TICKCYCLES), (int)(p->dldeadline / TICKCYCLES), p->dlmissed);
+		if (p->state != UNUSED && p->sclass == schedclass(SCHED_MLFQ)) {
+			nlevel[p->mlfqlevel]++;
+			nmlfq++;
+		}
+	}
+	for (i = 0; i < NMLFQ; i++) {
+		demoted = 0;
+		for (c = cpus; c < &cpus[NCPU]; c++)
+			demoted += c->mlfq.demotions[i];
+		if (nmlfq > 0 || demoted > 0)
+			printf("mlfq level %d: %d procs, %d demoted to it\n", i, nlevel[i], (int)demoted);
 	}
+	for (c = cpus; c < &cpus[NCPU]; c++) {
+		n += c->nwakeups;
+		total += c->wakecycles;
+		if (c->maxwakecycles > max)
+			max = c->maxwakecycles;
+	}
+	if (n > 0)
+		printf("wake-to-run: %d wakeups, avg %d cycles, max %d cycles\n", (int)n, (int)(total / n), (int)max);
 
 	// printf("system call sched_statistics!");
 	return;
@@ -832,20 +1204,137 @@ print_sched_statistics(void)
 set_sched_tickets(int t)
 {
 
-	if (t > 10000) {
-		printf("the number of tickets cannot exceed 10000!");
+	if (t > MAXTICKETS) {
+		printf("the number of tickets cannot exceed %d!", MAXTICKETS);
+		return;
+	}
+	if (t < 1) {
+		printf("the number of tickets must be at least 1!");
 		return;
 	}
 
 	struct proc *curproc = myproc();
 
-	curproc->tickets = t;
-	curproc->stride = stride1 / t;
-	curproc->pass = curproc->stride;
+	// pass keeps its place; only future strides change.
+	groupsettickets(curproc, t);
 	// printf("\nsystem call sched_tickets %d!\n", n);
 	return;
 }
 
+// Set the nice value of the process with the given pid,
+// or of the calling process if pid is 0.
+// Returns 0, or -1 if there is no such process or n is
+// out of range.
+	int
+set_sched_nice(int pid, int n)
+{
+	struct proc *p;
+
+	if(n < NICE_MIN || n > NICE_MAX)
+		return -1;
+	if(pid == 0)
+		pid = myproc()->pid;
+
+	for(p = proc; p < &proc[NPROC]; p++){
+		acquire(&p->lock);
+		if(p->pid == pid && p->state != UNUSED){
+			// only the weight of p's future runtime changes,
+			// so p keeps its place on any run queue.
+			p->nice = n;
+			release(&p->lock);
+			return 0;
+		}
+		release(&p->lock);
+	}
+	return -1;
+}
+
+// Make the calling process an EDF process that needs runtime
+// ticks of cpu time in every period ticks, by deadline ticks
+// after the period starts.
+// Returns 0, or -1 if the arguments are out of range or
+// admitting the process could make some deadline unmeetable.
+	int
+set_sched_deadline(int runtime, int period, int deadline)
+{
+	struct proc *p = myproc();
+	struct schedclass *edf = schedclass(SCHED_EDF);
+
+	if(runtime < 1 || deadline < runtime || period < deadline)
+		return -1;
+
+	acquire(&p->lock);
+	if(edfadmit(p, (uint64)runtime * TICKCYCLES, (uint64)period * TICKCYCLES,
+		    (uint64)deadline * TICKCYCLES) < 0){
+		release(&p->lock);
+		return -1;
+	}
+	runqsetclass(p, edf);
+	release(&p->lock);
+	return 0;
+}
+
+// Move the process with the given pid to scheduling
+// class policy, or, if pid is 0, make policy the default
+// and move every process but the real-time ones to it.
+// Returns the old policy, or -1.
+	int
+set_sched_policy(int pid, int policy)
+{
+	struct schedclass *cls, *old;
+	struct proc *p;
+
+	// real-time classes need sched_deadline().
+	if((cls = schedclass(policy)) == 0 || cls->rt)
+		return -1;
+
+	if(pid == 0){
+		old = schedsetdefault(cls);
+		for(p = proc; p < &proc[NPROC]; p++){
+			acquire(&p->lock);
+			if(p->state != UNUSED && !p->sclass->rt)
+				runqsetclass(p, cls);
+			release(&p->lock);
+		}
+		return old->policy;
+	}
+
+	for(p = proc; p < &proc[NPROC]; p++){
+		acquire(&p->lock);
+		if(p->pid == pid && p->state != UNUSED){
+			old = p->sclass;
+			runqsetclass(p, cls);
+			release(&p->lock);
+			return old->policy;
+		}
+		release(&p->lock);
+	}
+	return -1;
+}
+
+// Turn co-scheduling of the threads sharing the calling
+// process's address space on or off. While one of them
+// runs, the scheduler runs the others that are RUNNABLE
+// on other cpus too, and preempts them together.
+// Returns the old setting.
+	int
+set_sched_gang(int on)
+{
+	struct mm *mm = myproc()->mm;
+	int old;
+
+	acquire(&mm->lock);
+	old = mm->gang;
+	mm->gang = on != 0;
+	release(&mm->lock);
+	return old;
+}
+
+// Create a thread sharing p's address space, running on
+// stack if that is not 0, or else on a stack of its own that
+// grows on demand. The thread starts with tp 0: thread-local
+// storage is up to the user thread library (user/thread.c),
+// which points tp at a block on the new thread's stack.
 	int
 clone(void *stack)
 {
@@ -853,28 +1342,42 @@ clone(void *stack)
 	struct proc *np;
 	struct proc *p = myproc();
 
-	// Allocate process, check if the thread index is greater than 20 and if stack is NULL
-	if((np = allocproc(1)) == 0 || p->tid > 20 || !stack){
+	if((np = allocproc(1)) == 0)
 		return -1;
-	}
 
-	np->pagetable = p->pagetable;
-	np->sz = p->sz;
-	// map the trapframe page just below the trampoline page, for
-	// trampoline.S.
-	if(mappages(np->pagetable, TRAPFRAME - (PGSIZE * np->tid), PGSIZE,
-				(uint64)(np->trapframe), PTE_R | PTE_W) < 0){
-		uvmunmap(np->pagetable, TRAMPOLINE, 1, 0);
-		uvmfree(np->pagetable, 0);
-		return 0;
+	// map the trapframe page in a free slot below the
+	// trampoline page, for trampoline.S.
+	acquire(&tid_lock);
+	if((np->tslot = allocslot(p->mm)) >= 0){
+		acquire(&p->mm->lock);
+		if(mappages(p->pagetable, TRAPFRAME - PGSIZE * np->tslot, PGSIZE,
+					(uint64)(np->trapframe), PTE_R | PTE_W) < 0)
+			np->tslot = -1;
+		release(&p->mm->lock);
 	}
+	if(np->tslot < 0){
+		release(&tid_lock);
+		np->tslot = 0;
+		freeproc(np);
+		release(&np->lock);
+		return -1;
+	}
+	np->mm = mmdup(p->mm);
+	gangjoin(np->mm, np);
+	np->pagetable = p->pagetable;
+	release(&tid_lock);
+	np->ustack = (uint64)stack;
 
 	// copy saved user registers.
 	*(np->trapframe) = *(p->trapframe);
 
 	// Cause clone to return 0 in the child.
 	np->trapframe->a0 = 0;
-	np->trapframe->sp = (uint64)(stack + PGSIZE * sizeof(void));
+	if(stack)
+		np->trapframe->sp = (uint64)(stack + PGSIZE * sizeof(void));
+	else
+		np->trapframe->sp = TSTACK(np->tslot);
+	np->trapframe->tp = 0;
 	
 	// increment reference counts on open file descriptors.
 	for(i = 0; i < NOFILE; i++)
@@ -892,8 +1395,13 @@ clone(void *stack)
 	np->parent = p;
 	release(&wait_lock);
 
+	// a thread shares p's tickets instead of adding its own.
+	groupjoin(p, np);
+
 	acquire(&np->lock);
+	schedfork(p, np);
 	np->state = RUNNABLE;
+	runqadd(np);
 	release(&np->lock);
 
 	return tid;
@@ -18,12 +18,74 @@ struct context {
   uint64 s11;
 };
 
+// Each scheduling class's part of a cpu's run queue
+// (see sched_rr.c, sched_lottery.c and sched_stride.c).
+struct rrq {
+  struct proc *head;          // FIFO of RUNNABLE procs.
+  struct proc *tail;
+};
+
+// A min-heap of procs on p->rqkey (see sched.c).
+struct procheap {
+  struct proc *heap[NPROC];
+  int n;                      // Procs in the heap.
+};
+
+struct strideq {
+  struct procheap h;          // Keyed on pass.
+  uint64 vtime;               // Pass of the last proc picked.
+};
+
+struct cfsq {
+  struct procheap h;          // Keyed on vruntime.
+  uint64 minvruntime;         // Never decreases.
+};
+
+struct mlfqq {
+  struct proc *head[NMLFQ];   // A FIFO per level; 0 runs first.
+  struct proc *tail[NMLFQ];
+  uint64 epoch;               // Boost period the levels date from.
+  uint64 demotions[NMLFQ];    // Procs demoted into each level,
+                              // counted by the cpu they ran on.
+};
+
+struct edfq {
+  struct procheap h;          // Keyed on absolute deadline.
+  uint64 bw;                  // Admitted bandwidth, protected by dllock.
+};
+
+struct lotteryq {
+  int tree[NPROC+1];          // Fenwick tree of tickets by proc[] slot.
+  int total;                  // Sum of the tickets in tree.
+  uint64 rng;                 // This cpu's random number generator.
+};
+
 // Per-CPU state.
 struct cpu {
   struct proc *proc;          // The process running on this cpu, or null.
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  int idle;                   // Waiting in wfi for something to run?
+  int resched;                // Should the running proc give up the cpu?
+  int started;                // Has this hart booted and begun scheduling?
+  int tlbflush;               // Set by mmshootdown(); cleared once flushed.
+  uint64 nwakeups;            // Woken processes this cpu has run,
+  uint64 wakecycles;          // the cycles they waited in total,
+  uint64 maxwakecycles;       // and the longest wait.
+
+  // rqlock must be held when using these:
+  struct spinlock rqlock;
+  int nrunnable;              // RUNNABLE procs waiting for this cpu.
+  int nrt;                    // How many of them are real-time.
+  int rotor;                  // Class to try first in the next pick.
+  struct proc *throttled;     // RUNNABLE procs out of budget, on thnext.
+  struct rrq rr;
+  struct strideq stride;
+  struct lotteryq lottery;
+  struct cfsq cfs;
+  struct mlfqq mlfq;
+  struct edfq edf;
 };
 
 extern struct cpu cpus[NCPU];
@@ -79,6 +141,18 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
+// An address space, shared by a process and its threads.
+struct mm {
+  struct spinlock lock;        // Held to change sz or the user mappings
+  int ref;                     // Procs using it, under mmtable.lock
+  pagetable_t pagetable;       // User page table
+  uint64 sz;                   // Size of process memory (bytes)
+  int stackslot;               // Slot of a thread stack fork() copied in, or 0
+  int gang;                    // Co-schedule its threads; see sched_gang()
+  int growing;                 // A growproc() is under way, under lock
+  struct proc *members;        // Procs using it, on mmnext, under ganglock
+};
+
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
@@ -88,22 +162,60 @@ struct proc {
   // p->lock must be held when using these:
   enum procstate state;        // Process state
   void *chan;                  // If non-zero, sleeping on chan
+  struct proc *chnext;         // Next proc sleeping in chan's bucket
+  uint64 waketime;             // When wakeup() made p RUNNABLE, or 0
   int killed;                  // If non-zero, have been killed
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
   int syscall_count;
   int tickets;                 // the ticket value
+  int etickets;                // tickets p gets of its group's share
   int ticks;                   // number of times it has been scheduled to run
-  int stride;                  
-  int pass;                    // the length strided by the proc
+  int stride;                  // STRIDE1 / etickets
+  uint64 pass;                 // the length strided by the proc
+  int nice;                    // -20 (most cpu) to 19 (least), for CFS
+  uint64 vruntime;             // runtime scaled by nice's weight, for CFS
+  uint64 runtime;              // cycles spent running
+  uint64 dlruntime;            // EDF budget per period, in cycles
+  uint64 dlperiod;             // EDF period, in cycles
+  uint64 dldeadline;           // EDF deadline, in cycles from period start
+  uint64 dlbw;                 // EDF bandwidth admitted for p
+  int dlmissed;                // EDF deadlines p ran past
   int tid;                     // Thread ID
+  int tslot;                   // Trapframe slot below TRAPFRAME, 0 if not a thread
+  uint64 ustack;               // User stack given to clone(), handed back by join()
+  uint64 retval;               // Value passed to thread_exit(), for join()
+  struct cpu *cpu;             // Run queue p is on, or cpu it last ran on
+  struct schedclass *sclass;   // Scheduling class
+
+  // the run queue's rqlock must be held when using this:
+  struct proc *rqnext;         // Next and previous procs on the same run queue
+  struct proc *rqprev;
+  int onrq;                    // Is p waiting on its cpu's run queue?
+  int rqidx;                   // Index in the run queue's heap or tree
+  uint64 rqkey;                // Key in the run queue's heap
+  int rqtickets;               // Tickets p holds in the run queue's tree
+  int throttled;               // Out of budget until replenish?
+  uint64 replenish;            // Cycle count at which budget returns
+  struct proc *thnext;         // Next on the cpu's throttled list
+  uint64 dlstart;              // Start of the current EDF period
+  uint64 dlabs;                // Its absolute deadline
+  uint64 dlbudget;             // Cycles left to run in it
+  int dllate;                  // Has p already run past dlabs?
+  int mlfqlevel;               // MLFQ priority level
+  int mlfqused;                // Ticks p has run at that level
+  uint64 mlfqepoch;            // Boost period the level dates from
   // wait_lock must be held when using this:
   struct proc *parent;         // Parent process
 
+  // grouplock must be held when using this, and to change tickets:
+  struct proc *sgroup;         // Proc whose share p shares, or 0
+
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
-  uint64 sz;                   // Size of process memory (bytes)
-  pagetable_t pagetable;       // User page table
+  struct mm *mm;               // Address space
+  struct proc *mmnext;         // Next proc using mm, under ganglock
+  pagetable_t pagetable;       // User page table, the same as mm->pagetable
   struct trapframe *trapframe; // data page for trampoline.S
   struct context context;      // swtch() here to run process
   struct file *ofile[NOFILE];  // Open files
@@ -115,4 +227,42 @@ struct pinfo {
   int ppid;
   int syscall_count;
   int page_usage;
-};
\ No newline at end of file
+};
+
+// A scheduling class: a policy for ordering the RUNNABLE
+// processes on a cpu's run queue. The caller holds c->rqlock
+// for enqueue, dequeue, pick and tick.
+struct schedclass {
+  char *name;
+  int policy;                  // SCHED_* in sched.h
+  int rt;                      // Real-time: runs first, on its own cpu
+  void (*init)(struct cpu *c);
+  void (*enqueue)(struct cpu *c, struct proc *p);
+  void (*dequeue)(struct cpu *c, struct proc *p);
+  // Remove and return the next proc to run, or 0 if none.
+  struct proc *(*pick)(struct cpu *c);
+
+  // Optional; may be 0.
+  // Should p, just queued, run before cur, which is running?
+  // Called without c->rqlock, so the answer is a hint.
+  int (*preempt)(struct proc *cur, struct proc *p);
+  // A clock tick while p was running on c, which is this cpu.
+  // Returns 1 if p should give up the cpu. Without a tick
+  // hook, p gives it up at every tick.
+  int (*tick)(struct cpu *c, struct proc *p);
+  // p has just stopped running, after cycles of cpu time,
+  // and is not on a run queue. Called with p->lock held.
+  // May set p->throttled and p->replenish to keep p off
+  // its run queue until then.
+  void (*charge)(struct proc *p, uint64 cycles);
+  // p's budget is back; with c->rqlock held.
+  void (*replenish)(struct cpu *c, struct proc *p);
+  // p is leaving the class, or exiting. Called with p->lock held.
+  void (*detach)(struct proc *p);
+  // child, not yet RUNNABLE, was created by parent.
+  // Called with child->lock held and no rqlock.
+  void (*fork)(struct proc *parent, struct proc *child);
+  // p, just taken from from's queue, will run on to.
+  // Called with no rqlock held.
+  void (*migrate)(struct cpu *from, struct cpu *to, struct proc *p);
+};
@@ -0,0 +1,867 @@
+// Per-CPU run queues.
+//
+// Each cpu keeps the RUNNABLE processes that are waiting
+// for it on its own queue, protected by its own rqlock, so
+// that picking the next process does not have to touch
+// every p->lock in proc[]. A cpu whose queue is empty
+// steals from the busiest other cpu.
+//
+// Lock order: p->lock, then a cpu's rqlock.
+// The scheduler never holds an rqlock while acquiring a p->lock.
+//
+// How the processes on a queue are ordered is up to their
+// scheduling class (struct schedclass in proc.h), which
+// each process has its own of. Each cpu's queue has a part
+// for every class; real-time classes run first, and the cpu
+// takes turns among the others that have something to run.
+// sched_policy() moves one process, or all of them, to
+// another class at run time; the LAB2 build flag only
+// chooses the class they start in.
+//
+// A class may throttle a process that has used up its
+// budget. It then waits on its cpu's throttled list, not
+// counted in nrunnable, until its budget returns.
+//
+// A cpu with nothing to run waits in wfi with its clock
+// disarmed, or armed for the next budget to return (see
+// runqidle()). runqadd() sends an IPI to wake
+// an idle cpu when there is work for it, or to make a busy
+// cpu reschedule when the new process should run before the
+// one it is running.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+extern struct proc proc[NPROC];
+
+extern struct schedclass rr_class;
+extern struct schedclass lottery_class;
+extern struct schedclass stride_class;
+extern struct schedclass cfs_class;
+extern struct schedclass edf_class;
+extern struct schedclass mlfq_class;
+
+static void gangtick(struct proc*);
+
+// indexed by SCHED_*.
+static struct schedclass *classes[NSCHED] = {
+  [SCHED_RR] &rr_class,
+  [SCHED_LOTTERY] &lottery_class,
+  [SCHED_STRIDE] &stride_class,
+  [SCHED_CFS] &cfs_class,
+  [SCHED_EDF] &edf_class,
+  [SCHED_MLFQ] &mlfq_class,
+};
+
+// The class of processes that do not inherit one.
+#if defined(LOTTERY)
+static struct schedclass *defclass = &lottery_class;
+#elif defined(STRIDE)
+static struct schedclass *defclass = &stride_class;
+#elif defined(CFS)
+static struct schedclass *defclass = &cfs_class;
+#elif defined(MLFQ)
+static struct schedclass *defclass = &mlfq_class;
+#else
+static struct schedclass *defclass = &rr_class;
+#endif
+
+void
+runqinit(void)
+{
+  struct cpu *c;
+  int i;
+
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    initlock(&c->rqlock, "runq");
+    c->nrunnable = 0;
+    c->nrt = 0;
+    c->rotor = 0;
+    c->throttled = 0;
+    for(i = 0; i < NSCHED; i++)
+      classes[i]->init(c);
+  }
+}
+
+// Return the class for SCHED_* policy, or 0.
+struct schedclass*
+schedclass(int policy)
+{
+  if(policy < 0 || policy >= NSCHED)
+    return 0;
+  return classes[policy];
+}
+
+// Make cls the class of processes that do not inherit one.
+// Returns the previous one.
+struct schedclass*
+schedsetdefault(struct schedclass *cls)
+{
+  struct schedclass *old;
+
+  old = defclass;
+  defclass = cls;
+  return old;
+}
+
+// child takes parent's scheduling class and nice value,
+// or the default class if parent is 0 or real-time; a
+// real-time child would need a budget of its own.
+// allocproc() gives every new proc the default class, and
+// fork() and clone() then inherit the parent's.
+// Caller must hold child->lock; child must not be RUNNABLE yet.
+void
+schedfork(struct proc *parent, struct proc *child)
+{
+  if(parent == 0 || parent->sclass->rt){
+    child->sclass = defclass;
+    return;
+  }
+  child->sclass = parent->sclass;
+  child->nice = parent->nice;
+  if(child->sclass->fork)
+    child->sclass->fork(parent, child);
+}
+
+// p is exiting. Caller must hold p->lock.
+void
+schedexit(struct proc *p)
+{
+  if(p->sclass->detach)
+    p->sclass->detach(p);
+}
+
+// A clock tick while p is running on this cpu.
+// Decide whether p should give up the cpu.
+// Called with interrupts off.
+void
+schedtick(struct proc *p)
+{
+  struct cpu *c = mycpu();
+  struct proc *q;
+
+  gangtick(p);
+
+  acquire(&c->rqlock);
+  if(p->sclass->tick == 0 || p->sclass->tick(c, p))
+    c->resched = 1;
+
+  // a throttled proc's budget may have returned.
+  for(q = c->throttled; q; q = q->thnext)
+    if(!vbefore(clockcycles(), q->replenish))
+      c->resched = 1;
+  release(&c->rqlock);
+}
+
+// Should the process running on this cpu give it up, because
+// its time is up or because runqadd() queued one that should
+// run first? Called from trap handlers, with interrupts off.
+int
+schedresched(void)
+{
+  return mycpu()->resched;
+}
+
+// Does virtual time a come before b? Compare by the signed
+// difference, which stays correct if the times wrap, as
+// long as they are within 2^63 of each other.
+int
+vbefore(uint64 a, uint64 b)
+{
+  return (long)(a - b) < 0;
+}
+
+// Min-heaps of procs on p->rqkey, for the classes that run
+// the proc with the smallest virtual time. p->rqidx is p's
+// index in the heap. The caller holds the heap's rqlock.
+
+static void
+heapswap(struct procheap *h, int i, int j)
+{
+  struct proc *t;
+
+  t = h->heap[i];
+  h->heap[i] = h->heap[j];
+  h->heap[j] = t;
+  h->heap[i]->rqidx = i;
+  h->heap[j]->rqidx = j;
+}
+
+static void
+heapup(struct procheap *h, int i)
+{
+  while(i > 0 && vbefore(h->heap[i]->rqkey, h->heap[(i-1)/2]->rqkey)){
+    heapswap(h, i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void
+heapdown(struct procheap *h, int i)
+{
+  int l, r, min;
+
+  for(;;){
+    l = 2*i + 1;
+    r = 2*i + 2;
+    min = i;
+    if(l < h->n && vbefore(h->heap[l]->rqkey, h->heap[min]->rqkey))
+      min = l;
+    if(r < h->n && vbefore(h->heap[r]->rqkey, h->heap[min]->rqkey))
+      min = r;
+    if(min == i)
+      return;
+    heapswap(h, i, min);
+    i = min;
+  }
+}
+
+void
+heapinsert(struct procheap *h, struct proc *p)
+{
+  p->rqidx = h->n++;
+  h->heap[p->rqidx] = p;
+  heapup(h, p->rqidx);
+}
+
+void
+heapremove(struct procheap *h, struct proc *p)
+{
+  int i = p->rqidx;
+
+  h->n--;
+  if(i == h->n)
+    return;
+  h->heap[i] = h->heap[h->n];
+  h->heap[i]->rqidx = i;
+  heapup(h, i);
+  heapdown(h, h->heap[i]->rqidx);
+}
+
+// Remove and return the proc with the smallest key, or 0.
+struct proc*
+heappop(struct procheap *h)
+{
+  struct proc *p;
+
+  if(h->n == 0)
+    return 0;
+  p = h->heap[0];
+  heapremove(h, p);
+  return p;
+}
+
+// p joins (n = 1) or leaves (n = -1) the RUNNABLE procs
+// queued on c. Caller must hold c->rqlock.
+static void
+rqcount(struct cpu *c, struct proc *p, int n)
+{
+  c->nrunnable += n;
+  if(p->sclass->rt)
+    c->nrt += n;
+}
+
+// Should p, just queued, run before cur?
+// Real-time classes come before the others.
+static int
+rqpreempt(struct proc *cur, struct proc *p)
+{
+  if(cur->sclass != p->sclass)
+    return p->sclass->rt && !cur->sclass->rt;
+  return p->sclass->preempt && p->sclass->preempt(cur, p);
+}
+
+// Put p on the run queue of the cpu it last ran on,
+// or on this cpu's queue if it has never run.
+// A throttled p waits on the cpu's throttled list
+// instead, until runqreplenish() moves it.
+// Caller must hold p->lock and have set p->state to RUNNABLE.
+void
+runqadd(struct proc *p)
+{
+  struct proc *cur;
+  struct cpu *c;
+
+  if(!holding(&p->lock))
+    panic("runqadd p->lock");
+  if(p->state != RUNNABLE)
+    panic("runqadd state");
+
+  c = p->cpu;
+  if(c == 0)
+    c = p->cpu = mycpu();
+
+  acquire(&c->rqlock);
+  p->onrq = 1;
+  if(p->throttled){
+    p->thnext = c->throttled;
+    c->throttled = p;
+    release(&c->rqlock);
+    // an idle c must wake when p's budget returns.
+    if(c->idle)
+      sendipi(c - cpus);
+    return;
+  }
+  p->sclass->enqueue(c, p);
+  rqcount(c, p, 1);
+  release(&c->rqlock);
+
+  // release() is a fence, pairing with the one in runqidle().
+  // c->proc is read without a lock, so preemption is a hint.
+  cur = c->proc;
+  if(c->idle){
+    sendipi(c - cpus);
+  } else if(cur != 0 && rqpreempt(cur, p)){
+    c->resched = 1;
+    sendipi(c - cpus);
+  } else if(cur != 0){
+    // let an idle cpu steal it instead of waiting.
+    for(c = cpus; c < &cpus[NCPU]; c++){
+      if(c->idle){
+        sendipi(c - cpus);
+        break;
+      }
+    }
+  }
+}
+
+// Queue the throttled procs on c whose budget has returned.
+// Caller must hold c->rqlock.
+static void
+runqreplenish(struct cpu *c)
+{
+  struct proc *p, **pp;
+  uint64 now;
+
+  now = clockcycles();
+  pp = &c->throttled;
+  while((p = *pp) != 0){
+    if(vbefore(now, p->replenish)){
+      pp = &p->thnext;
+      continue;
+    }
+    *pp = p->thnext;
+    p->thnext = 0;
+    p->throttled = 0;
+    if(p->sclass->replenish)
+      p->sclass->replenish(c, p);
+    p->sclass->enqueue(c, p);
+    rqcount(c, p, 1);
+  }
+}
+
+// Take the next process to run from c's queue. Real-time
+// classes come first, and only for c itself, never a thief.
+// Caller must hold c->rqlock.
+static struct proc*
+rqpick(struct cpu *c, int steal)
+{
+  struct proc *p;
+  int i, k;
+
+  if(c->nrunnable == 0)
+    return 0;
+  for(i = 0; i < NSCHED && !steal; i++){
+    if(classes[i]->rt && (p = classes[i]->pick(c)) != 0)
+      return p;
+  }
+  // take turns among the other classes, so that one
+  // class cannot starve the others.
+  for(i = 0; i < NSCHED; i++){
+    k = (c->rotor + i) % NSCHED;
+    if(!classes[k]->rt && (p = classes[k]->pick(c)) != 0){
+      c->rotor = (k + 1) % NSCHED;
+      return p;
+    }
+  }
+  return 0;
+}
+
+// Take the next process to run from c's own queue.
+// Returns 0 if the queue is empty.
+// The caller must then acquire p->lock and check that
+// p is still RUNNABLE before running it.
+struct proc*
+runqtake(struct cpu *c)
+{
+  struct proc *p;
+
+  acquire(&c->rqlock);
+  runqreplenish(c);
+  if((p = rqpick(c, 0)) != 0){
+    rqcount(c, p, -1);
+    p->onrq = 0;
+  }
+  release(&c->rqlock);
+  return p;
+}
+
+// c's queue is empty; take a process from the cpu with
+// the most that may be stolen, which real-time ones may
+// not. nrunnable and nrt are read without the lock, so
+// this is only a hint; rqpick() re-checks.
+struct proc*
+runqsteal(struct cpu *c)
+{
+  struct cpu *victim, *busiest;
+  struct proc *p;
+  int most;
+
+  busiest = 0;
+  most = 0;
+  for(victim = cpus; victim < &cpus[NCPU]; victim++){
+    if(victim != c && victim->nrunnable - victim->nrt > most){
+      most = victim->nrunnable - victim->nrt;
+      busiest = victim;
+    }
+  }
+  if(busiest == 0)
+    return 0;
+  acquire(&busiest->rqlock);
+  if((p = rqpick(busiest, 1)) != 0){
+    rqcount(busiest, p, -1);
+    p->onrq = 0;
+  }
+  release(&busiest->rqlock);
+  if(p && p->sclass->migrate)
+    p->sclass->migrate(busiest, c, p);
+  return p;
+}
+
+// There is nothing for c to run, not even by stealing: wait
+// for an interrupt instead of spinning over the run queues.
+void
+runqidle(struct cpu *c)
+{
+  struct cpu *o;
+  struct proc *p;
+  uint64 wake, t;
+
+  // with interrupts off, an IPI that arrives from here on
+  // stays pending and makes wfi return at once.
+  intr_off();
+  c->idle = 1;
+  __sync_synchronize();
+
+  // wake for the first throttled proc's budget, and, on
+  // cpu 0, for the first timeout; 0 means never.
+  wake = 0;
+  acquire(&c->rqlock);
+  for(p = c->throttled; p; p = p->thnext){
+    t = (p->replenish + TICKCYCLES - 1) / TICKCYCLES;
+    if(wake == 0 || t < wake)
+      wake = t;
+  }
+  release(&c->rqlock);
+  if(c == &cpus[0] && (t = timeridle()) != 0 && (wake == 0 || t < wake))
+    wake = t;
+  clockset(wake);
+  __sync_synchronize();
+
+  // runqadd() may have queued work before it saw c->idle.
+  // Only work c could take counts: anything on its own
+  // queue, but on the others only what may be stolen.
+  for(o = cpus; o < &cpus[NCPU]; o++)
+    if(o == c ? o->nrunnable > 0 : o->nrunnable - o->nrt > 0)
+      break;
+  if(o == &cpus[NCPU])
+    wfi();
+  c->idle = 0;
+  intr_on();
+}
+
+// Take p off its run queue, if it is on one, so that its
+// class's ordering can change; runqrequeue() puts it back.
+// Caller must hold p->lock. Returns with p->cpu's rqlock held.
+static void
+runqunqueue(struct proc *p)
+{
+  struct cpu *c = p->cpu;
+  struct proc **pp;
+
+  if(c == 0)
+    return;
+  acquire(&c->rqlock);
+  if(!p->onrq)
+    return;
+  if(p->throttled){
+    for(pp = &c->throttled; *pp != p; pp = &(*pp)->thnext)
+      ;
+    *pp = p->thnext;
+  } else {
+    p->sclass->dequeue(c, p);
+    rqcount(c, p, -1);
+  }
+}
+
+static void
+runqrequeue(struct proc *p)
+{
+  struct cpu *c = p->cpu;
+
+  if(c == 0)
+    return;
+  if(p->onrq){
+    if(p->throttled){
+      p->thnext = c->throttled;
+      c->throttled = p;
+    } else {
+      p->sclass->enqueue(c, p);
+      rqcount(c, p, 1);
+    }
+  }
+  release(&c->rqlock);
+}
+
+// Give p t effective tickets. If p is waiting on a run
+// queue, its place there changes at once.
+// Caller must hold p->lock.
+static void
+runqsettickets(struct proc *p, int t)
+{
+  runqunqueue(p);
+  p->etickets = t;
+  p->stride = STRIDE1 / t;
+  runqrequeue(p);
+}
+
+// Move p to class cls. If p is waiting on a run queue,
+// it moves to cls's part of that queue. A throttle set by
+// p's old class does not apply to the new one.
+// Caller must hold p->lock.
+void
+runqsetclass(struct proc *p, struct schedclass *cls)
+{
+  if(p->sclass == cls)
+    return;
+  if(p->sclass->detach)
+    p->sclass->detach(p);
+  runqunqueue(p);
+  p->sclass = cls;
+  p->throttled = 0;
+  runqrequeue(p);
+}
+
+// Scheduling groups.
+//
+// A thread made by clone() joins the group of the proc that
+// made it, and shares that proc's tickets rather than adding
+// its own, so that a process cannot take more of the cpu by
+// making more threads. Each proc's group is the proc it was
+// cloned by, so groups nest: a group's share is split among
+// its leader and its members in proportion to their own
+// tickets, and a member that is itself a leader splits its
+// part again. The lottery and stride classes schedule on the
+// resulting effective tickets, p->etickets.
+//
+// Shares are split by membership, so a member that sleeps
+// keeps its part rather than passing it to the others.
+
+struct spinlock grouplock;
+
+// for groupupdate(), protected by grouplock.
+static struct proc *gqueue[NPROC];
+static uint64 gpool[NPROC];
+
+// Recompute the effective tickets of every proc in the
+// tree of groups that p is part of.
+// Caller must hold grouplock, and no p->lock.
+static void
+groupupdate(struct proc *p)
+{
+  struct proc *g, *q;
+  uint64 sum, share;
+  int i, n;
+
+  while(p->sgroup)
+    p = p->sgroup;
+  gqueue[0] = p;
+  gpool[0] = p->tickets;
+  n = 1;
+  for(i = 0; i < n; i++){
+    g = gqueue[i];
+    sum = g->tickets;
+    for(q = proc; q < &proc[NPROC]; q++)
+      if(q->sgroup == g)
+        sum += q->tickets;
+    for(q = proc; q < &proc[NPROC]; q++){
+      if(q->sgroup == g){
+        gqueue[n] = q;
+        gpool[n] = gpool[i] * q->tickets / sum;
+        n++;
+      }
+    }
+    // g keeps its own part of its pool.
+    gpool[i] = gpool[i] * g->tickets / sum;
+  }
+
+  for(i = 0; i < n; i++){
+    q = gqueue[i];
+    share = gpool[i] > 0 ? gpool[i] : 1;
+    acquire(&q->lock);
+    if(q->etickets != share)
+      runqsettickets(q, share);
+    release(&q->lock);
+  }
+}
+
+void
+groupinit(void)
+{
+  initlock(&grouplock, "group");
+}
+
+// child, made by clone(), joins parent's group.
+// Caller must hold no p->lock.
+void
+groupjoin(struct proc *parent, struct proc *child)
+{
+  acquire(&grouplock);
+  child->sgroup = parent;
+  groupupdate(parent);
+  release(&grouplock);
+}
+
+// p is exiting: leave its group, and pass its own members
+// to that group, or make them leaders if p had none.
+// Caller must hold no p->lock.
+void
+groupleave(struct proc *p)
+{
+  struct proc *g, *q;
+
+  acquire(&grouplock);
+  g = p->sgroup;
+  p->sgroup = 0;
+  for(q = proc; q < &proc[NPROC]; q++){
+    if(q->sgroup == p){
+      q->sgroup = g;
+      if(g == 0)
+        groupupdate(q);
+    }
+  }
+  if(g)
+    groupupdate(g);
+  release(&grouplock);
+}
+
+// Give p t tickets of its own.
+// Caller must hold no p->lock.
+void
+groupsettickets(struct proc *p, int t)
+{
+  acquire(&grouplock);
+  acquire(&p->lock);
+  p->tickets = t;
+  release(&p->lock);
+  groupupdate(p);
+  release(&grouplock);
+}
+
+// Gang scheduling.
+//
+// The threads of an address space whose mm->gang is set
+// (see sched_gang()) run as a gang: when one of them starts
+// running, it claims GANGSLICE ticks for its mm, and for
+// that slice cpus take the gang's RUNNABLE threads from any
+// queue before their own work, so that threads that wait
+// for each other, as with spin locks and barriers, wait
+// while the others run rather than for their turn to come.
+// When the slice ends, the gang's threads are preempted
+// together. Real-time classes still come first.
+//
+// Only one gang runs at a time. Gangs take turns by the
+// ordinary scheduling of their first thread.
+//
+// Each mm keeps a list of the procs using it, so that
+// finding a gang's threads does not scan proc[].
+//
+// Lock order: p->lock, then ganglock, then a cpu's rqlock.
+
+struct spinlock ganglock;
+
+// protected by ganglock; read without it as a hint.
+static struct mm *gangmm;      // the running gang, or 0
+static uint64 gangend;         // when its slice ends, in cycles
+
+void
+ganginit(void)
+{
+  initlock(&ganglock, "gang");
+}
+
+// p now uses mm.
+void
+gangjoin(struct mm *mm, struct proc *p)
+{
+  acquire(&ganglock);
+  p->mmnext = mm->members;
+  mm->members = p;
+  release(&ganglock);
+}
+
+// p is about to stop using p->mm, if it has joined it.
+void
+gangleave(struct proc *p)
+{
+  struct proc **pp;
+
+  if(p->mm == 0)
+    return;
+  acquire(&ganglock);
+  for(pp = &p->mm->members; *pp; pp = &(*pp)->mmnext){
+    if(*pp == p){
+      *pp = p->mmnext;
+      break;
+    }
+  }
+  p->mmnext = 0;
+  release(&ganglock);
+}
+
+// The running gang's mm, or 0 once its slice has ended.
+static struct mm*
+gangcur(void)
+{
+  struct mm *mm;
+
+  if(gangmm == 0)
+    return 0;
+  acquire(&ganglock);
+  if(gangmm && !vbefore(clockcycles(), gangend))
+    gangmm = 0;
+  mm = gangmm;
+  release(&ganglock);
+  return mm;
+}
+
+// Take a RUNNABLE thread of the running gang from any
+// cpu's queue, to run on c. Returns 0 if there is no gang
+// or none of its threads is waiting, or if c has a
+// real-time process to run first. Real-time threads stay
+// on their own cpu, as with stealing.
+struct proc*
+runqgang(struct cpu *c)
+{
+  struct mm *mm;
+  struct proc *p;
+  struct cpu *o;
+  int got;
+
+  if((mm = gangcur()) == 0)
+    return 0;
+
+  // nrt, p->onrq and p->cpu are read without the rqlocks,
+  // so these are hints; the rqlock re-checks.
+  if(c->nrt > 0)
+    return 0;
+
+  got = 0;
+  o = 0;
+  acquire(&ganglock);
+  for(p = mm->members; p; p = p->mmnext){
+    if(!p->onrq || p->throttled || (o = p->cpu) == 0)
+      continue;
+    acquire(&o->rqlock);
+    if(p->onrq && !p->throttled && p->cpu == o && !p->sclass->rt){
+      p->sclass->dequeue(o, p);
+      rqcount(o, p, -1);
+      p->onrq = 0;
+      got = 1;
+    }
+    release(&o->rqlock);
+    if(got)
+      break;
+  }
+  release(&ganglock);
+
+  if(!got)
+    return 0;
+  if(o != c && p->sclass->migrate)
+    p->sclass->migrate(o, c, p);
+  return p;
+}
+
+// p is about to run on this cpu. If it belongs to a gang
+// and no other gang is running, start a slice for p's gang,
+// and have other cpus run its waiting threads: idle ones
+// first, then ones running something other than the gang.
+// Caller must hold p->lock.
+void
+schedgang(struct proc *p)
+{
+  struct mm *mm = p->mm;
+  struct cpu *c = mycpu();
+  struct cpu *o;
+  struct proc *q;
+  uint64 now;
+  int n;
+
+  if(mm == 0 || !mm->gang)
+    return;
+
+  now = clockcycles();
+  acquire(&ganglock);
+  if(gangmm && vbefore(now, gangend)){
+    release(&ganglock);
+    return;
+  }
+  gangmm = mm;
+  gangend = now + GANGSLICE * TICKCYCLES;
+  n = 0;
+  for(q = mm->members; q; q = q->mmnext)
+    if(q != p && q->onrq && !q->throttled && !q->sclass->rt)
+      n++;
+  release(&ganglock);
+
+  for(o = cpus; o < &cpus[NCPU] && n > 0; o++){
+    if(o != c && o->idle){
+      sendipi(o - cpus);
+      n--;
+    }
+  }
+  for(o = cpus; o < &cpus[NCPU] && n > 0; o++){
+    q = o->proc;
+    if(o == c || o->idle || q == 0 || q->mm == mm || q->sclass->rt)
+      continue;
+    o->resched = 1;
+    sendipi(o - cpus);
+    n--;
+  }
+}
+
+// A clock tick while p is running on this cpu. If p is a
+// member of the running gang and the gang's slice is over,
+// preempt all of its threads.
+static void
+gangtick(struct proc *p)
+{
+  struct cpu *c = mycpu();
+  struct cpu *o;
+  struct mm *mm;
+
+  mm = p->mm;
+  if(mm == 0 || gangmm != mm)
+    return;
+  acquire(&ganglock);
+  if(gangmm != mm || vbefore(clockcycles(), gangend)){
+    release(&ganglock);
+    return;
+  }
+  gangmm = 0;
+  release(&ganglock);
+
+  c->resched = 1;
+  for(o = cpus; o < &cpus[NCPU]; o++){
+    if(o != c && o->proc && o->proc->mm == mm){
+      o->resched = 1;
+      sendipi(o - cpus);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+// Scheduling classes, for sched_policy().
+#define SCHED_RR       0  // round robin
+#define SCHED_LOTTERY  1  // lottery on tickets
+#define SCHED_STRIDE   2  // stride on tickets
+#define SCHED_CFS      3  // completely fair, on nice
+#define SCHED_EDF      4  // earliest deadline first; see sched_deadline()
+#define SCHED_MLFQ     5  // multi-level feedback queue
+#define NSCHED         6
+
+#define NICE_MIN     (-20)
+#define NICE_MAX       19
@@ -0,0 +1,116 @@
+// Completely fair scheduling class.
+//
+// Each process has a virtual runtime: the cycles it has
+// actually run, read from CLINT_MTIME when it stops, scaled
+// down by the weight of its nice value. Each cpu's queue is
+// a min-heap on vruntime, so the process that has had the
+// least of its fair share runs next. A process that blocks
+// early is charged only for the cycles it used.
+//
+// Each queue's minvruntime follows the vruntimes it picks.
+// A process that wakes up or arrives joins no further back
+// than a little before it, so it cannot hog the cpu to make
+// up for the time it slept.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+#define NICE0WEIGHT 1024
+#define SLEEPCREDIT (TICKCYCLES / 2)  // how far behind a waking proc may join
+#define WAKEGRAN    (TICKCYCLES / 4)  // lead a waking proc needs to preempt
+
+// Weight of each nice value, from NICE_MIN to NICE_MAX.
+// Each step is about 1.25 times the next, so one nice
+// level is about 10% more or less cpu.
+static int weights[NICE_MAX - NICE_MIN + 1] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+  9548, 7620, 6100, 4904, 3906,
+  3121, 2501, 1991, 1586, 1277,
+  1024, 820, 655, 526, 423,
+  335, 272, 215, 172, 137,
+  110, 87, 70, 56, 45,
+  36, 29, 23, 18, 15,
+};
+
+static void
+cfsinit(struct cpu *c)
+{
+  c->cfs.h.n = 0;
+  c->cfs.minvruntime = 0;
+}
+
+static void
+cfsenqueue(struct cpu *c, struct proc *p)
+{
+  uint64 floor = c->cfs.minvruntime - SLEEPCREDIT;
+
+  if(vbefore(p->vruntime, floor))
+    p->vruntime = floor;
+  p->rqkey = p->vruntime;
+  heapinsert(&c->cfs.h, p);
+}
+
+static void
+cfsdequeue(struct cpu *c, struct proc *p)
+{
+  heapremove(&c->cfs.h, p);
+}
+
+static struct proc*
+cfspick(struct cpu *c)
+{
+  struct proc *p;
+
+  if((p = heappop(&c->cfs.h)) == 0)
+    return 0;
+  if(vbefore(c->cfs.minvruntime, p->vruntime))
+    c->cfs.minvruntime = p->vruntime;
+  return p;
+}
+
+static int
+cfspreempt(struct proc *cur, struct proc *p)
+{
+  return vbefore(p->vruntime + WAKEGRAN, cur->vruntime);
+}
+
+static void
+cfscharge(struct proc *p, uint64 cycles)
+{
+  p->vruntime += cycles * NICE0WEIGHT / weights[p->nice - NICE_MIN];
+}
+
+// A child starts level with its parent.
+static void
+cfsfork(struct proc *parent, struct proc *child)
+{
+  child->vruntime = parent->vruntime;
+}
+
+// Keep p's lead over from's minvruntime,
+// measured against to's instead.
+static void
+cfsmigrate(struct cpu *from, struct cpu *to, struct proc *p)
+{
+  p->vruntime = p->vruntime - from->cfs.minvruntime + to->cfs.minvruntime;
+}
+
+struct schedclass cfs_class = {
+  .name = "cfs",
+  .policy = SCHED_CFS,
+  .init = cfsinit,
+  .enqueue = cfsenqueue,
+  .dequeue = cfsdequeue,
+  .pick = cfspick,
+  .preempt = cfspreempt,
+  .charge = cfscharge,
+  .fork = cfsfork,
+  .migrate = cfsmigrate,
+};
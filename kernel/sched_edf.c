@@ -0,0 +1,173 @@
+// Earliest-deadline-first real-time scheduling class.
+//
+// A process declares a budget of runtime cycles in every
+// period, due deadline cycles after the period starts (see
+// sched_deadline()). Each cpu's queue is a min-heap on
+// absolute deadline, and real-time classes run before all
+// the others.
+//
+// A process that uses up its budget is throttled until its
+// next period starts, so an overrun cannot take more than
+// the cpu time it declared. A process that wakes after its
+// deadline has passed starts a fresh period with a fresh
+// budget.
+//
+// Admission control keeps the sum of runtime/deadline of
+// the processes on each cpu below EDFMAXBW, which makes
+// every deadline feasible on that cpu. Each process stays on
+// the cpu it was admitted to; other cpus never steal it.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+#define BWONE    (1 << 20)          // bandwidth of a whole cpu
+#define EDFMAXBW (BWONE / 20 * 19)  // leave 5% for everything else
+
+// dllock must be held when using each cpu's edf.bw
+// and each EDF proc's dlbw.
+struct spinlock dllock;
+
+struct schedclass edf_class;
+
+// Start a new period at time start.
+static void
+newperiod(struct proc *p, uint64 start)
+{
+  p->dlstart = start;
+  p->dlabs = start + p->dldeadline;
+  p->dlbudget = p->dlruntime;
+  p->dllate = 0;
+}
+
+static void
+edfinit(struct cpu *c)
+{
+  if(c == cpus)
+    initlock(&dllock, "edf");
+  c->edf.h.n = 0;
+  c->edf.bw = 0;
+}
+
+static void
+edfenqueue(struct cpu *c, struct proc *p)
+{
+  uint64 now = clockcycles();
+
+  if(!vbefore(now, p->dlabs))
+    newperiod(p, now);
+  p->rqkey = p->dlabs;
+  heapinsert(&c->edf.h, p);
+}
+
+static void
+edfdequeue(struct cpu *c, struct proc *p)
+{
+  heapremove(&c->edf.h, p);
+}
+
+static struct proc*
+edfpick(struct cpu *c)
+{
+  return heappop(&c->edf.h);
+}
+
+static int
+edfpreempt(struct proc *cur, struct proc *p)
+{
+  return vbefore(p->dlabs, cur->dlabs);
+}
+
+static void
+edfcharge(struct proc *p, uint64 cycles)
+{
+  if(!p->dllate && vbefore(p->dlabs, clockcycles())){
+    p->dllate = 1;
+    p->dlmissed++;
+  }
+  if(cycles < p->dlbudget){
+    p->dlbudget -= cycles;
+    return;
+  }
+  p->dlbudget = 0;
+  p->throttled = 1;
+  p->replenish = p->dlstart + p->dlperiod;
+}
+
+static void
+edfreplenish(struct cpu *c, struct proc *p)
+{
+  newperiod(p, p->replenish);
+}
+
+static void
+edfdetach(struct proc *p)
+{
+  acquire(&dllock);
+  p->cpu->edf.bw -= p->dlbw;
+  p->dlbw = 0;
+  release(&dllock);
+}
+
+// Admit p, the calling process, to the EDF class with the
+// given budget, period and deadline, in cycles, on the
+// started cpu with the most bandwidth to spare; EDF procs
+// are never stolen, so one on a cpu with no hart would
+// never run. If p is already in the
+// class, its old bandwidth is given up first.
+// Returns 0, or -1 if no cpu has room; p is then unchanged.
+// Caller must hold p->lock.
+int
+edfadmit(struct proc *p, uint64 runtime, uint64 period, uint64 deadline)
+{
+  struct cpu *c, *best;
+  uint64 bw;
+
+  bw = runtime * BWONE / deadline;
+
+  acquire(&dllock);
+  if(p->sclass == &edf_class)
+    p->cpu->edf.bw -= p->dlbw;
+  best = mycpu();
+  for(c = cpus; c < &cpus[NCPU]; c++)
+    if(c->started && c->edf.bw < best->edf.bw)
+      best = c;
+  if(best->edf.bw + bw > EDFMAXBW){
+    if(p->sclass == &edf_class)
+      p->cpu->edf.bw += p->dlbw;
+    release(&dllock);
+    return -1;
+  }
+  best->edf.bw += bw;
+  p->dlbw = bw;
+  release(&dllock);
+
+  // p is running, so it is on no run queue;
+  // it will queue on best when it next stops.
+  p->cpu = best;
+  p->dlruntime = runtime;
+  p->dlperiod = period;
+  p->dldeadline = deadline;
+  p->dlabs = 0;
+  p->dlmissed = 0;
+  return 0;
+}
+
+struct schedclass edf_class = {
+  .name = "edf",
+  .policy = SCHED_EDF,
+  .rt = 1,
+  .init = edfinit,
+  .enqueue = edfenqueue,
+  .dequeue = edfdequeue,
+  .pick = edfpick,
+  .preempt = edfpreempt,
+  .charge = edfcharge,
+  .replenish = edfreplenish,
+  .detach = edfdetach,
+};
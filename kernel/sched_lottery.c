@@ -0,0 +1,104 @@
+// Lottery scheduling class.
+//
+// Each cpu keeps the tickets of its queued processes in a
+// Fenwick tree indexed by proc[] slot, so a draw and a ticket
+// change are both O(log NPROC). Each cpu has its own random
+// number generator.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+extern struct proc proc[NPROC];
+
+// xorshift64*, one generator per cpu.
+static uint64
+cpurand(struct cpu *c)
+{
+  uint64 x = c->lottery.rng;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  c->lottery.rng = x;
+  return x * 0x2545F4914F6CDD1Dull;
+}
+
+// Add delta to the tickets of proc[] slot i in c's tree.
+static void
+fenwickadd(struct cpu *c, int i, int delta)
+{
+  for(i++; i <= NPROC; i += i & -i)
+    c->lottery.tree[i] += delta;
+  c->lottery.total += delta;
+}
+
+// Return the proc[] slot whose range of tickets holds
+// ticket number n, where 0 <= n < c->lottery.total.
+static int
+fenwickfind(struct cpu *c, int n)
+{
+  int i, step;
+
+  i = 0;
+  for(step = 1; step*2 <= NPROC; step *= 2)
+    ;
+  for(; step > 0; step /= 2){
+    if(i + step <= NPROC && c->lottery.tree[i + step] <= n){
+      i += step;
+      n -= c->lottery.tree[i];
+    }
+  }
+  return i;
+}
+
+static void
+lotteryinit(struct cpu *c)
+{
+  memset(c->lottery.tree, 0, sizeof(c->lottery.tree));
+  c->lottery.total = 0;
+  // any nonzero seed will do, as long as each cpu's differs.
+  c->lottery.rng = 0x9E3779B97F4A7C15ull * (c - cpus + 1);
+}
+
+static void
+lotteryenqueue(struct cpu *c, struct proc *p)
+{
+  p->rqidx = p - proc;
+  p->rqtickets = p->etickets;
+  fenwickadd(c, p->rqidx, p->rqtickets);
+}
+
+static void
+lotterydequeue(struct cpu *c, struct proc *p)
+{
+  fenwickadd(c, p->rqidx, -p->rqtickets);
+}
+
+static struct proc*
+lotterypick(struct cpu *c)
+{
+  struct proc *p;
+
+  if(c->lottery.total == 0)
+    return 0;
+  p = &proc[fenwickfind(c, cpurand(c) % c->lottery.total)];
+  lotterydequeue(c, p);
+  return p;
+}
+
+// A lottery has no notion of who is due first,
+// so it needs no preempt hook.
+struct schedclass lottery_class = {
+  .name = "lottery",
+  .policy = SCHED_LOTTERY,
+  .init = lotteryinit,
+  .enqueue = lotteryenqueue,
+  .dequeue = lotterydequeue,
+  .pick = lotterypick,
+};
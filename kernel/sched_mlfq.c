@@ -0,0 +1,183 @@
+// Multi-level feedback queue scheduling class.
+//
+// Each cpu has a FIFO per priority level, and runs the
+// head of the highest non-empty level. A process starts
+// at level 0. One that runs for its level's whole quantum
+// moves down a level; one that blocks first keeps its level,
+// though the ticks it ran still count against the quantum,
+// so that yielding just before the quantum ends does not
+// keep a cpu hog at the top. Every MLFQBOOST ticks all
+// processes go back to level 0, so that those at the bottom
+// cannot starve.
+//
+// A process's level and ticks are kept under the rqlock of
+// p->cpu while it waits on that cpu's queue or runs there,
+// so that the boost, the tick and a change of class all see
+// the same level.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+// Ticks a process may run at each level before it moves
+// down; see sched_quantum().
+static int quanta[NMLFQ] = { 1, 2, 4 };
+
+static uint64
+boostepoch(void)
+{
+  return clockticks() / MLFQBOOST;
+}
+
+// If a boost has happened since p's level was set,
+// move p back to level 0.
+static void
+mlfqrefresh(struct proc *p, uint64 epoch)
+{
+  if(p->mlfqepoch != epoch){
+    p->mlfqepoch = epoch;
+    p->mlfqlevel = 0;
+    p->mlfqused = 0;
+  }
+}
+
+static void
+mlfqinit(struct cpu *c)
+{
+  int i;
+
+  for(i = 0; i < NMLFQ; i++){
+    c->mlfq.head[i] = 0;
+    c->mlfq.tail[i] = 0;
+    c->mlfq.demotions[i] = 0;
+  }
+  c->mlfq.epoch = 0;
+}
+
+static void
+mlfqenqueue(struct cpu *c, struct proc *p)
+{
+  struct mlfqq *q = &c->mlfq;
+  int l;
+
+  mlfqrefresh(p, boostepoch());
+  l = p->mlfqlevel;
+  p->rqnext = 0;
+  p->rqprev = q->tail[l];
+  if(q->tail[l])
+    q->tail[l]->rqnext = p;
+  else
+    q->head[l] = p;
+  q->tail[l] = p;
+}
+
+static void
+mlfqdequeue(struct cpu *c, struct proc *p)
+{
+  struct mlfqq *q = &c->mlfq;
+  int l = p->mlfqlevel;
+
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    q->head[l] = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    q->tail[l] = p->rqprev;
+  p->rqnext = 0;
+  p->rqprev = 0;
+}
+
+// If a boost has happened since c's queue was last
+// boosted, move everything on it to level 0, except
+// procs that have already run since the boost and so
+// have a level that dates from it.
+static void
+mlfqboost(struct cpu *c)
+{
+  struct mlfqq *q = &c->mlfq;
+  struct proc *p, *next;
+  uint64 epoch;
+  int i;
+
+  epoch = boostepoch();
+  if(q->epoch == epoch)
+    return;
+  q->epoch = epoch;
+  for(i = 1; i < NMLFQ; i++){
+    for(p = q->head[i]; p; p = next){
+      next = p->rqnext;
+      if(p->mlfqepoch != epoch){
+        mlfqdequeue(c, p);
+        mlfqenqueue(c, p);
+      }
+    }
+  }
+}
+
+static struct proc*
+mlfqpick(struct cpu *c)
+{
+  struct proc *p;
+  int i;
+
+  mlfqboost(c);
+  for(i = 0; i < NMLFQ; i++){
+    if((p = c->mlfq.head[i]) != 0){
+      mlfqdequeue(c, p);
+      return p;
+    }
+  }
+  return 0;
+}
+
+static int
+mlfqpreempt(struct proc *cur, struct proc *p)
+{
+  return p->mlfqlevel < cur->mlfqlevel;
+}
+
+static int
+mlfqtick(struct cpu *c, struct proc *p)
+{
+  mlfqrefresh(p, boostepoch());
+  if(++p->mlfqused < quanta[p->mlfqlevel])
+    return 0;
+  p->mlfqused = 0;
+  if(p->mlfqlevel < NMLFQ-1){
+    p->mlfqlevel++;
+    c->mlfq.demotions[p->mlfqlevel]++;
+  }
+  return 1;
+}
+
+// Set level's quantum to n ticks.
+// Returns the old quantum, or -1 if level or n is out of range.
+int
+mlfqsetquantum(int level, int n)
+{
+  int old;
+
+  if(level < 0 || level >= NMLFQ || n < 1)
+    return -1;
+  old = quanta[level];
+  quanta[level] = n;
+  return old;
+}
+
+struct schedclass mlfq_class = {
+  .name = "mlfq",
+  .policy = SCHED_MLFQ,
+  .init = mlfqinit,
+  .enqueue = mlfqenqueue,
+  .dequeue = mlfqdequeue,
+  .pick = mlfqpick,
+  .preempt = mlfqpreempt,
+  .tick = mlfqtick,
+};
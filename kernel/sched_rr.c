@@ -0,0 +1,67 @@
+// Round-robin scheduling class.
+//
+// Each cpu's queue is a FIFO; the process that has waited
+// longest runs next, for one clock tick.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+static void
+rrinit(struct cpu *c)
+{
+  c->rr.head = 0;
+  c->rr.tail = 0;
+}
+
+static void
+rrenqueue(struct cpu *c, struct proc *p)
+{
+  p->rqnext = 0;
+  p->rqprev = c->rr.tail;
+  if(c->rr.tail)
+    c->rr.tail->rqnext = p;
+  else
+    c->rr.head = p;
+  c->rr.tail = p;
+}
+
+static void
+rrdequeue(struct cpu *c, struct proc *p)
+{
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    c->rr.head = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    c->rr.tail = p->rqprev;
+  p->rqnext = 0;
+  p->rqprev = 0;
+}
+
+static struct proc*
+rrpick(struct cpu *c)
+{
+  struct proc *p;
+
+  p = c->rr.head;
+  if(p)
+    rrdequeue(c, p);
+  return p;
+}
+
+struct schedclass rr_class = {
+  .name = "rr",
+  .policy = SCHED_RR,
+  .init = rrinit,
+  .enqueue = rrenqueue,
+  .dequeue = rrdequeue,
+  .pick = rrpick,
+};
@@ -0,0 +1,86 @@
+// Stride scheduling class.
+//
+// Each cpu's queue is a min-heap on pass. Each queue has a
+// virtual time, the pass of the last process it picked;
+// processes that are new or that wake up join at that time,
+// so they neither run alone until they catch up nor bank
+// credit while asleep.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "defs.h"
+
+static void
+strideinit(struct cpu *c)
+{
+  c->stride.h.n = 0;
+  c->stride.vtime = 0;
+}
+
+static void
+strideenqueue(struct cpu *c, struct proc *p)
+{
+  if(vbefore(p->pass, c->stride.vtime))
+    p->pass = c->stride.vtime;
+  p->rqkey = p->pass;
+  heapinsert(&c->stride.h, p);
+}
+
+static void
+stridedequeue(struct cpu *c, struct proc *p)
+{
+  heapremove(&c->stride.h, p);
+}
+
+// Take the proc with the smallest pass and charge
+// it a stride for the turn it is about to get.
+static struct proc*
+stridepick(struct cpu *c)
+{
+  struct proc *p;
+
+  if((p = heappop(&c->stride.h)) == 0)
+    return 0;
+  c->stride.vtime = p->pass;
+  p->pass += p->stride;
+  return p;
+}
+
+// p is due before cur's next turn.
+static int
+stridepreempt(struct proc *cur, struct proc *p)
+{
+  return vbefore(p->pass, cur->pass);
+}
+
+// A child starts level with its parent.
+static void
+stridefork(struct proc *parent, struct proc *child)
+{
+  child->pass = parent->pass;
+}
+
+// Keep p's lead over from's virtual time,
+// measured against to's instead.
+static void
+stridemigrate(struct cpu *from, struct cpu *to, struct proc *p)
+{
+  p->pass = p->pass - from->stride.vtime + to->stride.vtime;
+}
+
+struct schedclass stride_class = {
+  .name = "stride",
+  .policy = SCHED_STRIDE,
+  .init = strideinit,
+  .enqueue = strideenqueue,
+  .dequeue = stridedequeue,
+  .pick = stridepick,
+  .preempt = stridepreempt,
+  .fork = stridefork,
+  .migrate = stridemigrate,
+};
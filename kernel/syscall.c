@@ -12,7 +12,8 @@ int
 fetchaddr(uint64 addr, uint64 *ip)
 {
   struct proc *p = myproc();
-  if(addr >= p->sz || addr+sizeof(uint64) > p->sz) // both tests needed, in case of overflow
+  if((addr >= p->mm->sz || addr+sizeof(uint64) > p->mm->sz) && // both tests needed, in case of overflow
+     (addr < USERTOP || addr+sizeof(uint64) > TSTACKTOP))    // or in the thread stacks
     return -1;
   if(copyin(p->pagetable, (char *)ip, addr, sizeof(*ip)) != 0)
     return -1;
@@ -106,6 +107,16 @@ extern uint64 sys_procinfo(void);
 extern uint64 sys_sched_statistics(void);
 extern uint64 sys_sched_tickets(void);
 extern uint64 sys_clone(void);
+extern uint64 sys_sched_policy(void);
+extern uint64 sys_sched_nice(void);
+extern uint64 sys_sched_deadline(void);
+extern uint64 sys_sched_quantum(void);
+extern uint64 sys_futex_wait(void);
+extern uint64 sys_futex_wake(void);
+extern uint64 sys_thread_exit(void);
+extern uint64 sys_join(void);
+extern uint64 sys_sched_gang(void);
+extern uint64 sys_memstat(void);
 
 // An array mapping syscall numbers from syscall.h
 // to the function that handles the system call.
@@ -135,7 +146,17 @@ static uint64 (*syscalls[])(void) = {
 [SYS_procinfo]                  sys_procinfo,
 [SYS_sched_statistics]          sys_sched_statistics,
 [SYS_sched_tickets]             sys_sched_tickets,
-[SYS_clone]   sys_clone
+[SYS_clone]   sys_clone,
+[SYS_sched_policy]              sys_sched_policy,
+[SYS_sched_nice]                sys_sched_nice,
+[SYS_sched_deadline]            sys_sched_deadline,
+[SYS_sched_quantum]             sys_sched_quantum,
+[SYS_futex_wait]                sys_futex_wait,
+[SYS_futex_wake]                sys_futex_wake,
+[SYS_thread_exit]               sys_thread_exit,
+[SYS_join]                      sys_join,
+[SYS_sched_gang]                sys_sched_gang,
+[SYS_memstat]                   sys_memstat,
 };
 
 void
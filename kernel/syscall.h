@@ -24,4 +24,14 @@
 #define SYS_procinfo  23        // lab1
 #define SYS_sched_statistics 24 // lab2
 #define SYS_sched_tickets  25   // lab2
-#define SYS_clone  26           // lab3
\ No newline at end of file
+#define SYS_clone  26           // lab3
+#define SYS_sched_policy 27
+#define SYS_sched_nice   28
+#define SYS_sched_deadline 29
+#define SYS_sched_quantum  30
+#define SYS_futex_wait     31
+#define SYS_futex_wake     32
+#define SYS_thread_exit    33
+#define SYS_join           34
+#define SYS_sched_gang     35
+#define SYS_memstat        36
\ No newline at end of file
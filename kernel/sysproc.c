@@ -5,6 +5,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "memstat.h"
 
 uint64
 sys_exit(void)
@@ -42,8 +43,7 @@ sys_sbrk(void)
   int n;
 
   argint(0, &n);
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  if(growproc(n, &addr) < 0)
     return -1;
   return addr;
 }
@@ -52,19 +52,15 @@ uint64
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   argint(0, &n);
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(killed(myproc())){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
+  if(n <= 0){
+    // sleep(0) lets other runnable processes have the cpu.
+    yield();
+    return 0;
   }
-  release(&tickslock);
+  if(sleepticks(n) < 0)
+    return -1;
   return 0;
 }
 
@@ -84,6 +80,8 @@ sys_uptime(void)
 {
   uint xticks;
 
+  // with every cpu idle, no clock interrupt counts the ticks.
+  clockintr();
   acquire(&tickslock);
   xticks = ticks;
   release(&tickslock);
@@ -129,4 +127,102 @@ sys_clone(void)
   uint64 p;
   argaddr(0, &p);
   return clone((void *)p);
-}
\ No newline at end of file
+}
+
+uint64
+sys_sched_policy(void)
+{
+  int pid, policy;
+  argint(0, &pid);
+  argint(1, &policy);
+  return set_sched_policy(pid, policy);
+}
+
+uint64
+sys_sched_nice(void)
+{
+  int pid, n;
+  argint(0, &pid);
+  argint(1, &n);
+  return set_sched_nice(pid, n);
+}
+
+uint64
+sys_sched_deadline(void)
+{
+  int runtime, period, deadline;
+  argint(0, &runtime);
+  argint(1, &period);
+  argint(2, &deadline);
+  return set_sched_deadline(runtime, period, deadline);
+}
+
+uint64
+sys_sched_quantum(void)
+{
+  int level, n;
+  argint(0, &level);
+  argint(1, &n);
+  return mlfqsetquantum(level, n);
+}
+
+uint64
+sys_futex_wait(void)
+{
+  uint64 addr;
+  int val;
+  argaddr(0, &addr);
+  argint(1, &val);
+  return futexwait(addr, val);
+}
+
+uint64
+sys_futex_wake(void)
+{
+  uint64 addr;
+  int n;
+  argaddr(0, &addr);
+  argint(1, &n);
+  return futexwake(addr, n);
+}
+
+uint64
+sys_thread_exit(void)
+{
+  uint64 retval;
+  argaddr(0, &retval);
+  thread_exit(retval);
+  return 0;  // not reached
+}
+
+uint64
+sys_join(void)
+{
+  int tid;
+  uint64 retval, stack;
+  argint(0, &tid);
+  argaddr(1, &retval);
+  argaddr(2, &stack);
+  return join(tid, retval, stack);
+}
+
+uint64
+sys_sched_gang(void)
+{
+  int on;
+  argint(0, &on);
+  return set_sched_gang(on);
+}
+
+uint64
+sys_memstat(void)
+{
+  uint64 addr;  // user pointer to struct memstat
+  struct memstat st;
+
+  argaddr(0, &addr);
+  kmemstat(&st);
+  if(copyout(myproc()->pagetable, addr, (char*)&st, sizeof(st)) < 0)
+    return -1;
+  return 0;
+}
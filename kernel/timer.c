@@ -0,0 +1,282 @@
+// Timeouts.
+//
+// Pending timers live in a hierarchical timing wheel: four
+// levels of 64 slots, each level counting in units 64 times
+// larger than the one below. A timer goes into the coarsest
+// level that can still tell its expiry apart from the present,
+// and is cascaded into a finer level when the wheel catches up
+// with its slot. Adding or cancelling a timer is O(1), and a
+// clock tick touches only the timers that expire on it, plus
+// the occasional cascade.
+//
+// While every cpu is idle no clock interrupt comes, and the
+// wheel falls behind the clock. Timeouts are therefore set
+// from clockticks(), not from the wheel's own count, and the
+// first tick after the idle period moves the wheel forward
+// in one jump (see timeradvance()).
+//
+// Timer callbacks run from the clock interrupt, on whichever
+// cpu counts the tick, with timerlock held. They must be short and must not call
+// timeradd() or timercancel(); waking a process with wakeup()
+// is fine.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "timer.h"
+#include "defs.h"
+
+#define WHEELBITS 6
+#define WHEELSIZE (1 << WHEELBITS)
+#define WHEELMASK (WHEELSIZE - 1)
+#define NLEVEL    4
+#define MAXDELAY  ((1L << (WHEELBITS*NLEVEL)) - 1)
+
+struct spinlock timerlock;
+
+static struct timer *wheel[NLEVEL][WHEELSIZE];
+static uint64 now;   // Number of ticks the wheel has processed.
+static uint64 armed; // Tick an idle cpu 0 will wake at; ~0 for never.
+
+void
+wheelinit(void)
+{
+  initlock(&timerlock, "timer");
+}
+
+void
+inittimer(struct timer *t, void (*fn)(void*), void *arg)
+{
+  t->fn = fn;
+  t->arg = arg;
+  t->next = 0;
+  t->pprev = 0;
+}
+
+// Link t into the slot for t->expires.
+// Caller must hold timerlock.
+static void
+timerlink(struct timer *t)
+{
+  struct timer **slot;
+  long delta;
+  uint64 e;
+  int level;
+
+  e = t->expires;
+  delta = (long)(e - now);
+  if(delta < 0)
+    e = now;             // overdue: run on this tick's slot
+  else if(delta > MAXDELAY)
+    e = now + MAXDELAY;  // too far: park at the top, cascade again later
+  delta = e - now;
+
+  for(level = 0; level < NLEVEL-1; level++)
+    if(delta < (1L << (WHEELBITS*(level+1))))
+      break;
+  slot = &wheel[level][(e >> (WHEELBITS*level)) & WHEELMASK];
+
+  t->next = *slot;
+  if(t->next)
+    t->next->pprev = &t->next;
+  *slot = t;
+  t->pprev = slot;
+}
+
+// Caller must hold timerlock.
+static void
+timerunlink(struct timer *t)
+{
+  *t->pprev = t->next;
+  if(t->next)
+    t->next->pprev = t->pprev;
+  t->next = 0;
+  t->pprev = 0;
+}
+
+// Move the timers in a slot of a coarse level down to the
+// finer levels. Returns the slot's index.
+static int
+cascade(int level)
+{
+  int i;
+  struct timer *t, *next;
+
+  i = (now >> (WHEELBITS*level)) & WHEELMASK;
+  t = wheel[level][i];
+  wheel[level][i] = 0;
+  for(; t; t = next){
+    next = t->next;
+    timerlink(t);
+  }
+  return i;
+}
+
+// Caller must hold timerlock.
+static void
+timerarm(struct timer *t, int n)
+{
+  if(t->pprev)
+    panic("timerarm");
+  t->expires = clockticks() + (n < 1 ? 1 : n);
+  timerlink(t);
+  // an idle cpu 0 may be asleep until a later timeout.
+  if(cpus[0].idle && t->expires < armed)
+    sendipi(0);
+}
+
+// Arrange for t->fn(t->arg) to be called n ticks from now.
+// t must not already be pending.
+void
+timeradd(struct timer *t, int n)
+{
+  acquire(&timerlock);
+  timerarm(t, n);
+  release(&timerlock);
+}
+
+// Stop t if it is pending.
+// Returns 1 if it was pending, 0 if it has already fired.
+int
+timercancel(struct timer *t)
+{
+  int pending;
+
+  acquire(&timerlock);
+  pending = t->pprev != 0;
+  if(pending)
+    timerunlink(t);
+  release(&timerlock);
+  return pending;
+}
+
+// The tick of the earliest pending timer, or ~0 if there is
+// none. Caller must hold timerlock.
+static uint64
+timerfirst(void)
+{
+  struct timer *t;
+  uint64 first;
+  int level, i;
+
+  first = ~0;
+  for(level = 0; level < NLEVEL; level++)
+    for(i = 0; i < WHEELSIZE; i++)
+      for(t = wheel[level][i]; t; t = t->next)
+        if(t->expires < first)
+          first = t->expires;
+  return first;
+}
+
+// Take every pending timer out of the wheel and link it again,
+// for a now that has jumped ahead.
+// Caller must hold timerlock.
+static void
+timerrelink(void)
+{
+  struct timer *list, *t;
+  int level, i;
+
+  list = 0;
+  for(level = 0; level < NLEVEL; level++){
+    for(i = 0; i < WHEELSIZE; i++){
+      while((t = wheel[level][i]) != 0){
+        timerunlink(t);
+        t->next = list;
+        list = t;
+      }
+    }
+  }
+  while((t = list) != 0){
+    list = t->next;
+    timerlink(t);
+  }
+}
+
+// Advance the wheel to tick to and run the timers that expire
+// on the way, in order. Usually to is the next tick. After
+// the cpus have all been idle, to may be far ahead; the wheel
+// then jumps to just before the next expiry, or to to, rather
+// than stepping through the ticks in between, so the time
+// this takes depends on the number of pending timers, not on
+// how long the cpus slept.
+// Called by clockintr().
+void
+timeradvance(uint64 to)
+{
+  struct timer *t;
+  uint64 next;
+  int level;
+
+  acquire(&timerlock);
+  while(now < to){
+    if(to > now + 1){
+      if((next = timerfirst()) > to)
+        next = to;
+      if(next > now + 1){
+        now = next - 1;
+        timerrelink();
+      }
+    }
+    now++;
+    if((now & WHEELMASK) == 0)
+      for(level = 1; level < NLEVEL && cascade(level) == 0; level++)
+        ;
+    while((t = wheel[0][now & WHEELMASK]) != 0){
+      timerunlink(t);
+      t->fn(t->arg);
+    }
+  }
+  release(&timerlock);
+}
+
+// An idle cpu 0 wakes for timeouts, while the other idle cpus
+// sleep until something else interrupts them. Return the tick
+// of the earliest pending timer, for cpu 0 to arm its clock
+// for, or 0 if there is none. Called by cpu 0 after it has
+// marked itself idle, so that timeradd() interrupts it if an
+// earlier timer arrives afterwards.
+uint64
+timeridle(void)
+{
+  acquire(&timerlock);
+  armed = timerfirst();
+  release(&timerlock);
+  return armed == ~0 ? 0 : armed;
+}
+
+static void
+timerwakeup(void *chan)
+{
+  wakeup(chan);
+}
+
+// Sleep for n clock ticks.
+// Returns -1 if the process is killed first, 0 otherwise.
+int
+sleepticks(int n)
+{
+  struct timer t;
+  int r;
+
+  if(n <= 0)
+    return 0;
+  inittimer(&t, timerwakeup, &t);
+
+  acquire(&timerlock);
+  timerarm(&t, n);
+  r = 0;
+  while(t.pprev){
+    if(killed(myproc())){
+      timerunlink(&t);
+      r = -1;
+      break;
+    }
+    sleep(&t, &timerlock);
+  }
+  release(&timerlock);
+  return r;
+}
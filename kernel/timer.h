@@ -0,0 +1,10 @@
+// Kernel timeouts, driven by the clock interrupt.
+struct timer {
+  uint64 expires;         // Tick at which fn is called
+  void (*fn)(void*);      // Called with timerlock held
+  void *arg;
+
+  // timerlock must be held when using these:
+  struct timer *next;     // Next timer in the same wheel slot
+  struct timer **pprev;   // Link pointing at this timer; 0 if not pending
+};
@@ -10,6 +10,7 @@ struct spinlock tickslock;
 uint ticks;
 
 extern char trampoline[], uservec[], userret[];
+extern uint64 timer_scratch[NCPU][6]; // start.c
 
 // in kernelvec.S, calls kerneltrap().
 void kernelvec();
@@ -65,6 +66,9 @@ usertrap(void)
     intr_on();
 
     syscall();
+  } else if((r_scause() == 13 || r_scause() == 15) &&
+            tstackgrow(p->pagetable, r_stval()) != 0){
+    // load or store page fault in the thread's stack, now mapped.
   } else if((which_dev = devintr()) != 0){
     // ok
   } else {
@@ -76,8 +80,8 @@ usertrap(void)
   if(killed(p))
     exit(-1);
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2)
+  // give up the CPU if the scheduler wants it back.
+  if(which_dev == 2 && schedresched())
     yield();
 
   usertrapret();
@@ -126,7 +130,7 @@ usertrapret(void)
   // switches to the user page table, restores user registers,
   // and switches to user mode with sret.
   uint64 trampoline_userret = TRAMPOLINE + (userret - trampoline);
-  ((void (*)(uint64,uint64))trampoline_userret)(TRAPFRAME - PGSIZE * p->tid, satp);
+  ((void (*)(uint64,uint64))trampoline_userret)(TRAPFRAME - PGSIZE * p->tslot, satp);
 }
 
 // interrupts and exceptions from kernel code go here via kernelvec,
@@ -150,8 +154,9 @@ kerneltrap()
     panic("kerneltrap");
   }
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
+  // give up the CPU if the scheduler wants it back.
+  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING &&
+     schedresched())
     yield();
 
   // the yield() may have caused some traps to occur,
@@ -160,12 +165,56 @@ kerneltrap()
   w_sstatus(sstatus);
 }
 
+// Timer cycles since boot, according to the CLINT.
+uint64
+clockcycles(void)
+{
+  return *(uint64*)CLINT_MTIME;
+}
+
+// Clock ticks since boot.
+uint64
+clockticks(void)
+{
+  return clockcycles() / TICKCYCLES;
+}
+
+// Arrange for this hart's next timer interrupt to arrive
+// at clock tick t, or never if t is 0. Harts are not
+// interrupted at a fixed interval: one running a process
+// asks for the next tick so that the process can be
+// preempted, and an idle one only for the next timeout.
+void
+clockset(uint64 t)
+{
+  *(uint64*)CLINT_MTIMECMP(cpuid()) = t ? t * TICKCYCLES : -1;
+}
+
+// Interrupt hart id: wake it if it is idle in wfi, and
+// make it reschedule if it is running a process.
+// The CLINT raises a machine-mode software interrupt,
+// which timervec in kernelvec.S forwards as a supervisor one.
+void
+sendipi(int id)
+{
+  *(uint32*)CLINT_MSIP(id) = 1;
+}
+
+// Any hart may take the clock interrupt for a tick, and idle
+// harts take none, so catch up with however many ticks have
+// passed since the last one counted, in one step.
 void
 clockintr()
 {
+  uint64 now = clockticks();
+
+  if(ticks >= now)
+    return;
   acquire(&tickslock);
-  ticks++;
-  wakeup(&ticks);
+  if(ticks < now){
+    ticks = now;
+    timeradvance(now);
+  }
   release(&tickslock);
 }
 
@@ -203,16 +252,36 @@ devintr()
     return 1;
   } else if(scause == 0x8000000000000001L){
     // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // or from another hart's sendipi(), forwarded by
+    // timervec in kernelvec.S. either way, the caller
+    // reschedules if schedtick() or runqadd() asked it to.
 
-    if(cpuid() == 0){
-      clockintr();
-    }
-    
     // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
+    // the SSIP bit in sip, before looking at the timer
+    // flag, so that a timer interrupt from here on raises
+    // SSIP again rather than being lost.
     w_sip(r_sip() & ~2);
 
+    // another cpu has unmapped pages of the process that
+    // runs here; see mmshootdown().
+    if(mycpu()->tlbflush){
+      sfence_vma();
+      mycpu()->tlbflush = 0;
+    }
+
+    // only the timer counts as a tick; an IPI has already
+    // set whatever it wanted this hart to notice.
+    if(__sync_lock_test_and_set(&timer_scratch[cpuid()][5], 0)){
+      clockintr();
+
+      // timervec disarmed the timer. a hart with no process
+      // rearms it in scheduler() instead.
+      if(myproc() != 0){
+        clockset(clockticks() + 1);
+        schedtick(myproc());
+      }
+    }
+
     return 2;
   } else {
     return 0;
@@ -0,0 +1,114 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Run a periodic job next to background load, first as a
+// best-effort process and then as an EDF process, and report
+// how many deadlines each missed. Each job needs about a tick
+// of cpu time. The load is some cpu hogs and a process that
+// forks and reaps children, standing in for grind, whose
+// children outlive it and so could not be killed afterwards.
+#define RUNTIME 2  // ticks of budget per period
+#define PERIOD 10  // ticks
+#define DEADLINE 5 // ticks after the period starts
+#define JOBS 20
+#define NHOG 8
+
+volatile int sink;
+
+// A unit of work: a thousand additions.
+void work(int units)
+{
+    for (int i = 0; i < units; i++)
+        for (int j = 0; j < 1000; j++)
+            sink += j;
+}
+
+// How many units of work fit in a tick, on an idle machine.
+int calibrate(void)
+{
+    int t, units = 0;
+
+    t = uptime();
+    while (uptime() == t)
+        ;
+    t = uptime();
+    while (uptime() < t + 5) {
+        work(1);
+        units++;
+    }
+    return units / 5;
+}
+
+// Release a job every PERIOD ticks; return how many
+// finished more than DEADLINE ticks after release.
+int jobs(int units)
+{
+    int start, release, now, missed = 0;
+
+    start = uptime();
+    for (int k = 0; k < JOBS; k++) {
+        release = start + k * PERIOD;
+        if ((now = uptime()) < release)
+            sleep(release - now);
+        work(units);
+        if (uptime() > release + DEADLINE)
+            missed++;
+    }
+    return missed;
+}
+
+// Fork and reap short-lived children until killed.
+void churn(void)
+{
+    while (1) {
+        if (fork() == 0) {
+            work(1);
+            exit(0);
+        }
+        wait(0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int units, besteffort, edf, n;
+    int pids[NHOG + 1];
+
+    units = calibrate();
+    printf("edftest: %d units of work per tick\n", units);
+
+    // background load; remember only our own children, so
+    // that killing the load kills nothing else.
+    n = 0;
+    for (int i = 0; i <= NHOG; i++) {
+        if ((pids[n] = fork()) == 0) { // child process
+            if (i == 0)
+                churn();
+            while (1)
+                ;
+        }
+        if (pids[n] > 0)
+            n++;
+    }
+    sleep(10);
+
+    besteffort = jobs(units);
+    printf("best-effort: %d of %d deadlines missed\n", besteffort, JOBS);
+
+    if (sched_deadline(RUNTIME, PERIOD, DEADLINE) < 0) {
+        printf("edftest: sched_deadline refused\n");
+        edf = -1;
+    } else {
+        edf = jobs(units);
+        printf("edf: %d of %d deadlines missed\n", edf, JOBS);
+        sched_statistics();
+    }
+
+    for (int i = 0; i < n; i++)
+        kill(pids[i]);
+    while (wait(0) >= 0)
+        ;
+
+    exit(edf > besteffort ? -1 : 0);
+}
@@ -0,0 +1,208 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "thread.h"
+#include "green.h"
+#include "user.h"
+
+// Green threads share one FIFO run queue. Each carrier, a
+// kernel thread from thread_create(), loops taking the next
+// green thread off the queue and gswtch()ing to it; the green
+// thread runs until it yields or returns, which gswtch()es
+// back to its carrier's loop. Only then does the carrier put
+// it back on the queue or free it, so no other carrier can
+// pick up a green thread whose stack is still in use.
+//
+// A green thread may resume on a different carrier than it
+// yielded from; tp, and so the TLS block that finds the
+// current carrier, always belongs to the carrier.
+//
+// Finished green threads go on a free list and their memory
+// is reused by later spawns, so a switch or a spawn costs a
+// few dozen instructions and no system call.
+//
+// A green stack has no guard page below it, only a canary
+// word at its bottom that the carrier checks each time the
+// green thread switches back; one that has run off the end
+// of its stack stops the program before it can do more harm.
+
+#define GCANARY 0x6772656e73746b21UL  // "grenstk!"
+
+enum { GREADY, GDONE };
+
+struct green {
+    struct gcontext ctx;
+    void (*fn)(void*);
+    void *arg;
+    int state;
+    struct green *next;  // on the run queue or the free list
+    // the stack follows, GSTACK bytes, GCANARY at its bottom
+};
+
+struct carrier {
+    struct gcontext ctx;  // the carrier's loop, to go back to
+    struct green *cur;    // green thread running, or 0
+    int tid;
+};
+
+void gswtch(struct gcontext*, struct gcontext*);
+
+// glock protects the run queue, the free list and nlive.
+static struct lock_t glock;
+static struct green *runhead, *runtail, *freelist;
+static int nlive;  // spawned and not finished
+static struct carrier carriers[NCPU];
+static int carrierkey = -1;
+
+static struct carrier *
+mycarrier(void)
+{
+    return tls_get(carrierkey);
+}
+
+static uint64 *
+canary(struct green *g)
+{
+    return (uint64 *)(g + 1);
+}
+
+static void
+enqueue(struct green *g)
+{
+    g->next = 0;
+    if (runtail)
+        runtail->next = g;
+    else
+        runhead = g;
+    runtail = g;
+}
+
+// A new green thread's first gswtch() returns here.
+static void
+gstart(void)
+{
+    struct green *g = mycarrier()->cur;
+
+    g->fn(g->arg);
+    g->state = GDONE;
+    gswtch(&g->ctx, &mycarrier()->ctx);
+}
+
+// Create a green thread to run fn(arg). Can be called before
+// green_run() or from a green thread. Return 0, or -1 if out
+// of memory.
+int
+green_spawn(void (*fn)(void*), void *arg)
+{
+    struct green *g;
+
+    lock_acquire(&glock);
+    if ((g = freelist) != 0) {
+        freelist = g->next;
+    } else if ((g = malloc(sizeof(struct green) + GSTACK)) == 0) {
+        lock_release(&glock);
+        return -1;
+    }
+    memset(&g->ctx, 0, sizeof(g->ctx));
+    g->ctx.ra = (uint64)gstart;
+    g->ctx.sp = ((uint64)(g + 1) + GSTACK) & ~15UL;
+    *canary(g) = GCANARY;
+    g->fn = fn;
+    g->arg = arg;
+    g->state = GREADY;
+    nlive++;
+    enqueue(g);
+    lock_release(&glock);
+    return 0;
+}
+
+// Let other green threads run. Outside a green thread, let
+// other kernel threads and processes run.
+void
+green_yield(void)
+{
+    struct carrier *c = carrierkey < 0 ? 0 : mycarrier();
+
+    if (c == 0 || c->cur == 0) {
+        sleep(0);
+        return;
+    }
+    gswtch(&c->cur->ctx, &c->ctx);
+}
+
+static void *
+carrierloop(void *arg)
+{
+    struct carrier *c = arg;
+    struct green *g;
+
+    tls_set(carrierkey, c);
+    for (;;) {
+        lock_acquire(&glock);
+        if ((g = runhead) != 0) {
+            if ((runhead = g->next) == 0)
+                runtail = 0;
+        } else if (nlive == 0) {
+            lock_release(&glock);
+            break;
+        }
+        lock_release(&glock);
+        if (g == 0) {
+            // Everything left is running on other carriers.
+            sleep(0);
+            continue;
+        }
+
+        c->cur = g;
+        gswtch(&c->ctx, &g->ctx);
+        c->cur = 0;
+        if (*canary(g) != GCANARY) {
+            printf("green: stack overflow\n");
+            exit(1);
+        }
+
+        lock_acquire(&glock);
+        if (g->state == GDONE) {
+            g->next = freelist;
+            freelist = g;
+            nlive--;
+        } else {
+            enqueue(g);
+        }
+        lock_release(&glock);
+    }
+    return 0;
+}
+
+// Run green threads on n carriers, the caller and n-1 new
+// kernel threads, until all of them have finished. Return 0,
+// or -1 if n is out of range or a carrier could not start.
+int
+green_run(int n)
+{
+    struct green *g;
+    int i, r = 0;
+
+    if (n < 1 || n > NCPU)
+        return -1;
+    if (carrierkey < 0 && (carrierkey = tls_alloc()) < 0)
+        return -1;
+    for (i = 1; i < n; i++) {
+        if ((carriers[i].tid = thread_create(carrierloop, &carriers[i])) < 0) {
+            r = -1;
+            break;
+        }
+    }
+    n = i;
+    carrierloop(&carriers[0]);
+    for (i = 1; i < n; i++)
+        thread_join(carriers[i].tid, 0);
+    tls_set(carrierkey, 0);
+
+    // Give the stacks back to malloc now that no other
+    // thread can be using it.
+    while ((g = freelist) != 0) {
+        freelist = g->next;
+        free(g);
+    }
+    return r;
+}
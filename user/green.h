@@ -0,0 +1,17 @@
+// Green threads: cooperative user-level threads multiplexed
+// M:N over a few kernel threads ("carriers"). Needs
+// kernel/types.h first.
+
+#define GSTACK 4096  // bytes of stack per green thread
+
+// Saved registers for gswtch.S; the same layout as the
+// kernel's struct context.
+struct gcontext {
+    uint64 ra;
+    uint64 sp;
+    uint64 s[12];
+};
+
+int green_spawn(void (*fn)(void*), void *arg);
+void green_yield(void);
+int green_run(int ncarriers);
@@ -0,0 +1,64 @@
+#include "kernel/types.h"
+#include "user/user.h"
+#include "user/thread.h"
+#include "user/green.h"
+
+// Spawn NGREEN green threads that each yield a few times, and
+// run them on 1 to MAXCARRIERS carriers; then time a pair of
+// green threads yielding to each other on one carrier.
+#define NGREEN 5000  // with GSTACK 4096, about 21MB of stacks
+#define NYIELD 3
+#define MAXCARRIERS 4
+#define PINGPONG 100000
+
+int counter;
+
+void task(void *arg)
+{
+    for (int i = 0; i < NYIELD; i++) {
+        __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+        green_yield();
+    }
+}
+
+void pingpong(void *arg)
+{
+    for (int i = 0; i < PINGPONG; i++)
+        green_yield();
+}
+
+int main(int argc, char *argv[])
+{
+    int t;
+
+    for (int n = 1; n <= MAXCARRIERS; n++) {
+        counter = 0;
+        t = uptime();
+        for (int i = 0; i < NGREEN; i++) {
+            if (green_spawn(task, 0) < 0) {
+                printf("greentest: green_spawn failed at %d\n", i);
+                exit(1);
+            }
+        }
+        if (green_run(n) < 0) {
+            printf("greentest: green_run(%d) failed\n", n);
+            exit(1);
+        }
+        t = uptime() - t;
+        if (counter != NGREEN * NYIELD) {
+            printf("greentest: %d carriers: counted %d, want %d\n",
+                   n, counter, NGREEN * NYIELD);
+            exit(1);
+        }
+        printf("%d green threads on %d carriers: %d ticks\n", NGREEN, n, t);
+    }
+
+    green_spawn(pingpong, 0);
+    green_spawn(pingpong, 0);
+    t = uptime();
+    green_run(1);
+    t = uptime() - t;
+    printf("%d switches: %d ticks\n", 2 * PINGPONG, t);
+    printf("greentest: OK\n");
+    exit(0);
+}
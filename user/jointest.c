@@ -0,0 +1,139 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "user/thread.h"
+
+// Create and join threads in batches, many more of them than
+// a process can hold at once, and check that each returns its
+// value and that no memory leaks from one batch to the next.
+// Each thread keeps its argument in a thread-local variable
+// across a yield. Then check that threads see each other's
+// sbrk(), and that a thread's stack grows well past a page.
+#define BATCH 16
+#define ROUNDS 40
+
+int key;
+
+void *twice(void *arg)
+{
+    tls_set(key, arg);
+    sleep(0);
+    return (void *)((uint64)tls_get(key) * 2);
+}
+
+// Like twice(), but leaves through thread_exit().
+void *twice_exit(void *arg)
+{
+    thread_exit(twice(arg));
+}
+
+// Run one batch; return the number of wrong results.
+int batch(int round)
+{
+    int tid[BATCH];
+    void *ret;
+    int bad = 0;
+
+    for (int i = 0; i < BATCH; i++) {
+        tid[i] = thread_create(i % 2 ? twice : twice_exit, (void *)(uint64)i);
+        if (tid[i] < 0) {
+            printf("jointest: round %d: thread_create failed\n", round);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < BATCH; i++) {
+        if (thread_join(tid[i], &ret) < 0) {
+            printf("jointest: round %d: thread_join(%d) failed\n", round, tid[i]);
+            exit(1);
+        }
+        if ((uint64)ret != i * 2)
+            bad++;
+    }
+    return bad;
+}
+
+// Grow the heap by a few pages and fill them in.
+void *grow(void *arg)
+{
+    char *p = sbrk(4 * 4096);
+
+    if (p == (char *)-1)
+        return 0;
+    memset(p, 'x', 4 * 4096);
+    return p + 4 * 4096;
+}
+
+// Return 1 if the heap a thread grew is visible here.
+int heap(void)
+{
+    void *end;
+    int tid;
+
+    if ((tid = thread_create(grow, 0)) < 0 || thread_join(tid, &end) < 0 ||
+        end == 0)
+        return 0;
+    return sbrk(0) == end && ((char *)end)[-1] == 'x';
+}
+
+// Use about depth KB of stack, and return depth.
+int recurse(int depth)
+{
+    volatile char frame[1024];
+
+    frame[0] = depth;
+    if (depth > 1)
+        return recurse(depth - 1) + 1 + frame[0] - depth;
+    return 1;
+}
+
+void *deep(void *arg)
+{
+    return (void *)(uint64)recurse((uint64)arg);
+}
+
+int main(int argc, char *argv[])
+{
+    int before, after, bad;
+
+    key = tls_alloc();
+    tls_set(key, (void *)-1);
+    // Thread stacks come from the kernel's stack slots. The
+    // first batch maps page-table pages for the slots; later
+    // batches reuse them and should free every page they use.
+    bad = batch(0);
+    before = sysinfo(2);
+    for (int r = 1; r < ROUNDS; r++)
+        bad += batch(r);
+    after = sysinfo(2);
+
+    if (thread_join(12345, 0) >= 0) {
+        printf("jointest: joined a thread that does not exist\n");
+        exit(1);
+    }
+
+    printf("%d threads, %d wrong results, free pages %d -> %d\n",
+           BATCH * ROUNDS, bad, before, after);
+    if (tls_get(key) != (void *)-1) {
+        printf("jointest: a thread changed main's thread-local variable\n");
+        exit(1);
+    }
+
+    if (!heap()) {
+        printf("jointest: sbrk() in a thread not seen by the process\n");
+        exit(1);
+    }
+
+    void *depth;
+    int tid = thread_create(deep, (void *)100);
+    if (tid < 0 || thread_join(tid, &depth) < 0 || (uint64)depth != 100) {
+        printf("jointest: a thread could not use 100KB of stack\n");
+        exit(1);
+    }
+
+    if (bad || after != before) {
+        printf("jointest: FAILED\n");
+        exit(1);
+    }
+    printf("jointest: OK\n");
+    exit(0);
+}
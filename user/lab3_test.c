@@ -2,8 +2,11 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "user/thread.h"
+#define MAX_THREADS 64
 struct lock_t lock;
 int n_threads, n_passes, cur_turn, cur_pass;
+// lock holds that found it was another thread's turn.
+int n_wasted;
 void* thread_fn(void *arg)
 {
 	int thread_id = (uint64)arg;
@@ -16,6 +19,7 @@ void* thread_fn(void *arg)
 			printf("Round %d: thread %d is passing the token to thread %d\n",
 					++cur_pass, thread_id, cur_turn); 
 					}
+		else n_wasted++;
 			lock_release(&lock);
 			sleep(0); 
 			}
@@ -24,16 +28,31 @@ void* thread_fn(void *arg)
 int main(int argc, char *argv[])
 {
 	if (argc < 3) {
-		printf("Usage: %s [N_PASSES] [N_THREADS]\n", argv[0]); exit(-1);
+		printf("Usage: %s [N_PASSES] [N_THREADS] [gang|nogang]\n", argv[0]); exit(-1);
 	}
+	// with a third argument, report how long the threads spent
+	// waiting for their turn, with or without gang scheduling.
+	int measure = argc > 3;
+	if (measure) sched_gang(strcmp(argv[3], "gang") == 0);
+	int start = uptime();
 	n_passes = atoi(argv[1]);
 	n_threads = atoi(argv[2]);
+	if (n_threads < 1 || n_threads > MAX_THREADS) {
+		printf("%s: N_THREADS must be 1..%d\n", argv[0], MAX_THREADS); exit(-1);
+	}
+	int tid[MAX_THREADS];
 	cur_turn = 0;
 	cur_pass = 0;
 	lock_init(&lock);
-	for (int i = 0; i < n_threads; i++) { thread_create(thread_fn, (void*)(uint64)i);
+	for (int i = 0; i < n_threads; i++) {
+		if ((tid[i] = thread_create(thread_fn, (void*)(uint64)i)) < 0) {
+			printf("%s: thread_create failed\n", argv[0]); exit(-1);
+		}
 	}
 	for (int i = 0; i < n_threads; i++) {
-		wait(0); }
-	printf("Frisbee simulation has finished, %d rounds played in total\n", n_passes); exit(0);
+		thread_join(tid[i], 0); }
+	printf("Frisbee simulation has finished, %d rounds played in total\n", n_passes);
+	if (measure)
+		printf("%s: %d wasted turns, %d ticks\n", argv[3], n_wasted, uptime() - start);
+	exit(0);
 }
@@ -0,0 +1,108 @@
+#include "kernel/types.h"
+#include "user/user.h"
+#include "user/thread.h"
+#include "user/sync.h"
+
+// Contention microbenchmark: 1, 2, 4 and 8 threads each
+// increment a shared counter ITERS times under one lock, for
+// each kind of lock, and the time taken is printed in ticks.
+#define ITERS 20000
+#define MAXTHREADS 8
+
+enum { LOCKT, TICKET, MCS, RWLOCK, SEMA, NKIND };
+char *kindname[] = { "lock_t", "ticket", "mcs", "rwlock", "sema" };
+
+struct lock_t lockt;
+struct ticketlock ticket;
+struct mcslock mcs;
+struct rwlock rw;
+struct sema sema;
+struct barrier start;
+int kind;
+volatile int counter;
+
+void *worker(void *arg)
+{
+    struct mcsnode node;
+
+    barrier_wait(&start);
+    for (int i = 0; i < ITERS; i++) {
+        switch (kind) {
+        case LOCKT:
+            lock_acquire(&lockt);
+            counter++;
+            lock_release(&lockt);
+            break;
+        case TICKET:
+            ticketlock_acquire(&ticket);
+            counter++;
+            ticketlock_release(&ticket);
+            break;
+        case MCS:
+            mcslock_acquire(&mcs, &node);
+            counter++;
+            mcslock_release(&mcs, &node);
+            break;
+        case RWLOCK:
+            rwlock_wrlock(&rw);
+            counter++;
+            rwlock_wrunlock(&rw);
+            break;
+        case SEMA:
+            sema_down(&sema);
+            counter++;
+            sema_up(&sema);
+            break;
+        }
+    }
+    return 0;
+}
+
+// Return the ticks n threads take, or -1 on a wrong count.
+int run(int n)
+{
+    int tid[MAXTHREADS], t;
+
+    lock_init(&lockt);
+    ticketlock_init(&ticket);
+    mcslock_init(&mcs);
+    rwlock_init(&rw);
+    sema_init(&sema, 1);
+    barrier_init(&start, n + 1);
+    counter = 0;
+    for (int i = 0; i < n; i++) {
+        if ((tid[i] = thread_create(worker, 0)) < 0) {
+            printf("lockbench: thread_create failed\n");
+            exit(1);
+        }
+    }
+    barrier_wait(&start);
+    t = uptime();
+    for (int i = 0; i < n; i++)
+        thread_join(tid[i], 0);
+    t = uptime() - t;
+    return counter == n * ITERS ? t : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    int t;
+
+    printf("ticks for %d increments per thread\n", ITERS);
+    printf("threads");
+    for (kind = 0; kind < NKIND; kind++)
+        printf("  %s", kindname[kind]);
+    printf("\n");
+    for (int n = 1; n <= MAXTHREADS; n *= 2) {
+        printf("%d      ", n);
+        for (kind = 0; kind < NKIND; kind++) {
+            if ((t = run(n)) < 0) {
+                printf("\nlockbench: %s lost updates\n", kindname[kind]);
+                exit(1);
+            }
+            printf("  %d", t);
+        }
+        printf("\n");
+    }
+    exit(0);
+}
@@ -0,0 +1,33 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/memstat.h"
+#include "user/user.h"
+
+// memstat
+// prints the kernel's physical page counts, by use.
+
+static char *names[NMEM] = {
+  [MEM_PAGETABLE] "pagetable",
+  [MEM_KSTACK]    "kstack",
+  [MEM_PIPE]      "pipe",
+  [MEM_TRAPFRAME] "trapframe",
+  [MEM_USER]      "user",
+  [MEM_OTHER]     "other",
+};
+
+int
+main(int argc, char **argv)
+{
+  struct memstat st;
+  int k;
+
+  if(memstat(&st) < 0){
+    fprintf(2, "memstat: failed\n");
+    exit(1);
+  }
+  printf("total %d free %d low %d\n", (int)st.total, (int)st.free,
+         (int)st.freelow);
+  for(k = 0; k < NMEM; k++)
+    printf("%s %d high %d\n", names[k], (int)st.used[k], (int)st.usedhigh[k]);
+  exit(0);
+}
@@ -0,0 +1,98 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/sched.h"
+#include "user/user.h"
+
+// Check that an MLFQ process that mostly sleeps stays ahead
+// of cpu hogs, while pairs of processes passing a byte back
+// and forth over pipes make wakeups, and the IPIs they send,
+// land on every cpu. Only clock ticks the process was
+// running for may count against its quantum; were the
+// others charged too, it would sink to the hogs' level and
+// wait its turn behind them after every sleep, and the
+// sleeps would take several times longer.
+#define NPAIR 2     // ping-pong pairs
+#define NHOG 6      // cpu hogs, a couple per cpu
+#define ROUNDS 100  // sleeps of the interactive process
+#define SLACK 3     // ticks a sleep(1) may take, on average
+
+volatile int sink;
+
+// Pass a byte back and forth on p and q until killed.
+void pingpong(int *p, int *q, int first)
+{
+    char c = 0;
+
+    if (first)
+        write(p[1], &c, 1);
+    while (1) {
+        if (read(q[0], &c, 1) != 1)
+            exit(0);
+        write(p[1], &c, 1);
+    }
+}
+
+// Spin until killed.
+void hog(void)
+{
+    for (int j = 0; ; j++)
+        sink += j;
+}
+
+// Sleep a tick at a time, doing a little work after each
+// wakeup; exit with the ticks that took.
+void interactive(void)
+{
+    int t0 = uptime();
+
+    for (int r = 0; r < ROUNDS; r++) {
+        sleep(1);
+        for (int j = 0; j < 1000; j++)
+            sink += j;
+    }
+    exit(uptime() - t0);
+}
+
+int main(int argc, char *argv[])
+{
+    int a[2], b[2], pids[2 * NPAIR + NHOG], n, pid, w, ticks;
+
+    if (sched_policy(getpid(), SCHED_MLFQ) < 0) {
+        printf("mlfqtest: sched_policy failed\n");
+        exit(1);
+    }
+
+    n = 0;
+    for (int i = 0; i < NPAIR; i++) {
+        pipe(a);
+        pipe(b);
+        if ((pids[n++] = fork()) == 0)
+            pingpong(a, b, 1);
+        if ((pids[n++] = fork()) == 0)
+            pingpong(b, a, 0);
+        close(a[0]); close(a[1]);
+        close(b[0]); close(b[1]);
+    }
+    for (int i = 0; i < NHOG; i++)
+        if ((pids[n++] = fork()) == 0)
+            hog();
+
+    if ((pid = fork()) == 0)
+        interactive();
+    ticks = -1;
+    while ((w = wait(&ticks)) != pid && w >= 0)
+        ;
+
+    for (int i = 0; i < n; i++)
+        kill(pids[i]);
+    while (wait(0) >= 0)
+        ;
+
+    printf("mlfqtest: %d sleeps of 1 tick took %d ticks\n", ROUNDS, ticks);
+    if (ticks < 0 || ticks > SLACK * ROUNDS) {
+        printf("mlfqtest: FAIL\n");
+        exit(1);
+    }
+    printf("mlfqtest: OK\n");
+    exit(0);
+}
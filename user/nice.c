@@ -0,0 +1,29 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// nice n command [arg...]
+// runs command with nice value n, for the cfs policy.
+
+int
+main(int argc, char **argv)
+{
+  int n;
+
+  if(argc < 3){
+    fprintf(2, "usage: nice n command [arg...]\n");
+    exit(1);
+  }
+  // atoi() takes no sign.
+  if(argv[1][0] == '-')
+    n = -atoi(argv[1] + 1);
+  else
+    n = atoi(argv[1]);
+  if(sched_nice(0, n) < 0){
+    fprintf(2, "nice: bad nice value %s\n", argv[1]);
+    exit(1);
+  }
+  exec(argv[2], argv + 2);
+  fprintf(2, "nice: exec %s failed\n", argv[2]);
+  exit(1);
+}
@@ -0,0 +1,46 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Bounce a byte between two processes over a pair of pipes.
+// Each round trip is two wakeups, usually across harts, so
+// the rate measures wake-to-run latency.
+int main(int argc, char *argv[])
+{
+    int n, start, elapsed, p2c[2], c2p[2];
+    char b = 0;
+
+    if (argc < 2) {
+        printf("Usage: %s [ROUND_TRIPS]\n", argv[0]);
+        exit(-1);
+    }
+    n = atoi(argv[1]);
+    if (pipe(p2c) < 0 || pipe(c2p) < 0) {
+        printf("pingpong: pipe failed\n");
+        exit(-1);
+    }
+
+    if (fork() == 0) { // child process
+        for (int i = 0; i < n; i++) {
+            if (read(p2c[0], &b, 1) != 1)
+                exit(-1);
+            write(c2p[1], &b, 1);
+        }
+        exit(0);
+    }
+
+    start = uptime();
+    for (int i = 0; i < n; i++) {
+        write(p2c[1], &b, 1);
+        if (read(c2p[0], &b, 1) != 1) {
+            printf("pingpong: read failed\n");
+            exit(-1);
+        }
+    }
+    elapsed = uptime() - start;
+    wait(0);
+
+    printf("%d round trips in %d ticks\n", n, elapsed);
+    sched_statistics();
+    exit(0);
+}
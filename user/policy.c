@@ -0,0 +1,49 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/sched.h"
+#include "user/user.h"
+
+// policy rr|lottery|stride|cfs|mlfq [pid...]
+// moves the processes to a scheduling class, or,
+// with no pids, makes it the default for all of them.
+
+char *names[NSCHED] = {
+  [SCHED_RR] "rr",
+  [SCHED_LOTTERY] "lottery",
+  [SCHED_STRIDE] "stride",
+  [SCHED_CFS] "cfs",
+  [SCHED_EDF] "edf",  // refused; see sched_deadline()
+  [SCHED_MLFQ] "mlfq",
+};
+
+int
+main(int argc, char **argv)
+{
+  int i, policy, old;
+
+  if(argc < 2){
+    fprintf(2, "usage: policy rr|lottery|stride|cfs|mlfq [pid...]\n");
+    exit(1);
+  }
+  for(policy = 0; policy < NSCHED; policy++)
+    if(strcmp(argv[1], names[policy]) == 0)
+      break;
+  if(policy == NSCHED){
+    fprintf(2, "policy: unknown policy %s\n", argv[1]);
+    exit(1);
+  }
+
+  if(argc == 2){
+    if((old = sched_policy(0, policy)) < 0){
+      fprintf(2, "policy: failed\n");
+      exit(1);
+    }
+    printf("%s -> %s\n", names[old], names[policy]);
+    exit(0);
+  }
+  for(i=2; i<argc; i++){
+    if(sched_policy(atoi(argv[i]), policy) < 0)
+      fprintf(2, "policy: no process %s\n", argv[i]);
+  }
+  exit(0);
+}
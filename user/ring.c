@@ -0,0 +1,135 @@
+#include "kernel/types.h"
+#include "ring.h"
+#include "user.h"
+
+// The single-producer queue needs no atomic read-modify-write
+// at all: each index has one writer, and release stores
+// paired with acquire loads (fences on RISC-V) order the slot
+// contents against the index that publishes them.
+//
+// The multi-producer queue is Vyukov's bounded MPMC queue.
+// Every cell carries a sequence number saying whose turn it
+// is: seq == pos means free for the producer claiming
+// position pos, seq == pos+1 means full for the consumer of
+// pos. Producers and consumers claim positions with a
+// compare-and-swap (lr/sc on RISC-V) on enq or deq and then
+// touch only their own cell, so neither side takes a lock and
+// a slow thread holds up only the one cell it claimed.
+
+int
+spsc_init(struct spscq *q, int size)
+{
+    if (size < 2 || (size & (size - 1)) != 0)
+        return -1;
+    if ((q->buf = malloc(size * sizeof(void*))) == 0)
+        return -1;
+    q->head = q->tail = 0;
+    q->mask = size - 1;
+    return 0;
+}
+
+void
+spsc_free(struct spscq *q)
+{
+    free(q->buf);
+    q->buf = 0;
+}
+
+int
+spsc_push(struct spscq *q, void *v)
+{
+    uint64 tail = q->tail;
+
+    if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask)
+        return 0;
+    q->buf[tail & q->mask] = v;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int
+spsc_pop(struct spscq *q, void **v)
+{
+    uint64 head = q->head;
+
+    if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE))
+        return 0;
+    *v = q->buf[head & q->mask];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int
+mpmc_init(struct mpmcq *q, int size)
+{
+    if (size < 2 || (size & (size - 1)) != 0)
+        return -1;
+    if ((q->cells = malloc(size * sizeof(struct mpmccell))) == 0)
+        return -1;
+    for (int i = 0; i < size; i++)
+        q->cells[i].seq = i;
+    q->enq = q->deq = 0;
+    q->mask = size - 1;
+    return 0;
+}
+
+void
+mpmc_free(struct mpmcq *q)
+{
+    free(q->cells);
+    q->cells = 0;
+}
+
+int
+mpmc_push(struct mpmcq *q, void *v)
+{
+    uint64 pos = __atomic_load_n(&q->enq, __ATOMIC_RELAXED);
+    struct mpmccell *c;
+    long d;
+
+    for (;;) {
+        c = &q->cells[pos & q->mask];
+        d = (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pos);
+        if (d == 0) {
+            // Free for pos: claim it, or learn the new enq.
+            if (__atomic_compare_exchange_n(&q->enq, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (d < 0) {
+            // Still full from a lap ago.
+            return 0;
+        } else {
+            pos = __atomic_load_n(&q->enq, __ATOMIC_RELAXED);
+        }
+    }
+    c->data = v;
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int
+mpmc_pop(struct mpmcq *q, void **v)
+{
+    uint64 pos = __atomic_load_n(&q->deq, __ATOMIC_RELAXED);
+    struct mpmccell *c;
+    long d;
+
+    for (;;) {
+        c = &q->cells[pos & q->mask];
+        d = (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (d == 0) {
+            if (__atomic_compare_exchange_n(&q->deq, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (d < 0) {
+            // Not yet written.
+            return 0;
+        } else {
+            pos = __atomic_load_n(&q->deq, __ATOMIC_RELAXED);
+        }
+    }
+    *v = c->data;
+    // Free the cell for the producer one lap later.
+    __atomic_store_n(&c->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+    return 1;
+}
@@ -0,0 +1,36 @@
+// Bounded lock-free queues of pointers for passing messages
+// between threads. Needs kernel/types.h first.
+//
+// Sizes must be powers of two. push and pop never block: they
+// return 0 when the queue is full or empty, and the caller
+// decides whether to spin, yield or do something else.
+
+// Single producer, single consumer.
+struct spscq {
+    uint64 head __attribute__((aligned(64)));  // next to pop, consumer's
+    uint64 tail __attribute__((aligned(64)));  // next to push, producer's
+    uint64 mask __attribute__((aligned(64)));
+    void **buf;
+};
+
+// Any number of producers and consumers.
+struct mpmccell {
+    uint64 seq;
+    void *data;
+};
+
+struct mpmcq {
+    uint64 enq __attribute__((aligned(64)));
+    uint64 deq __attribute__((aligned(64)));
+    uint64 mask __attribute__((aligned(64)));
+    struct mpmccell *cells;
+};
+
+int spsc_init(struct spscq *q, int size);
+void spsc_free(struct spscq *q);
+int spsc_push(struct spscq *q, void *v);
+int spsc_pop(struct spscq *q, void **v);
+int mpmc_init(struct mpmcq *q, int size);
+void mpmc_free(struct mpmcq *q);
+int mpmc_push(struct mpmcq *q, void *v);
+int mpmc_pop(struct mpmcq *q, void **v);
@@ -0,0 +1,107 @@
+#include "kernel/types.h"
+#include "user/user.h"
+#include "user/thread.h"
+#include "user/ring.h"
+
+// Throughput of the lock-free queues: producers push the
+// numbers 1..NMSG between them, consumers pop until all have
+// arrived, and the sum checks that each came through once.
+// Rates assume TICKHZ clock ticks per second.
+#define NMSG 200000
+#define QSIZE 1024
+#define TICKHZ 10
+#define SPINS 100  // failed tries before a thread yields
+
+struct spscq spsc;
+struct mpmcq mpmc;
+int usempmc, nprod, ncons;
+uint64 sent, received, sum;
+
+int push(void *v)
+{
+    return usempmc ? mpmc_push(&mpmc, v) : spsc_push(&spsc, v);
+}
+
+int pop(void **v)
+{
+    return usempmc ? mpmc_pop(&mpmc, v) : spsc_pop(&spsc, v);
+}
+
+void *producer(void *arg)
+{
+    uint64 m;
+    int tries = 0;
+
+    while ((m = __atomic_add_fetch(&sent, 1, __ATOMIC_RELAXED)) <= NMSG) {
+        while (!push((void *)m)) {
+            if (++tries % SPINS == 0)
+                sleep(0);
+        }
+    }
+    return 0;
+}
+
+void *consumer(void *arg)
+{
+    void *v;
+    uint64 mysum = 0;
+    int tries = 0;
+
+    while (__atomic_load_n(&received, __ATOMIC_RELAXED) < NMSG) {
+        if (pop(&v)) {
+            mysum += (uint64)v;
+            __atomic_add_fetch(&received, 1, __ATOMIC_RELAXED);
+        } else if (++tries % SPINS == 0) {
+            sleep(0);
+        }
+    }
+    __atomic_add_fetch(&sum, mysum, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void run(char *name, int mpmcq, int np, int nc)
+{
+    int tid[16], n = 0, t;
+
+    usempmc = mpmcq;
+    sent = received = sum = 0;
+    if (mpmcq ? mpmc_init(&mpmc, QSIZE) : spsc_init(&spsc, QSIZE)) {
+        printf("ringbench: init failed\n");
+        exit(1);
+    }
+    t = uptime();
+    for (int i = 0; i < np; i++)
+        tid[n++] = thread_create(producer, 0);
+    for (int i = 0; i < nc; i++)
+        tid[n++] = thread_create(consumer, 0);
+    for (int i = 0; i < n; i++) {
+        if (tid[i] < 0) {
+            printf("ringbench: thread_create failed\n");
+            exit(1);
+        }
+        thread_join(tid[i], 0);
+    }
+    t = uptime() - t;
+    if (mpmcq)
+        mpmc_free(&mpmc);
+    else
+        spsc_free(&spsc);
+
+    if (sum != (uint64)NMSG * (NMSG + 1) / 2) {
+        printf("ringbench: %s: messages lost or duplicated\n", name);
+        exit(1);
+    }
+    if (t == 0)
+        t = 1;
+    printf("%s %dp/%dc: %d ticks, %d msgs/tick, about %d msgs/s\n",
+           name, np, nc, t, NMSG / t, NMSG / t * TICKHZ);
+}
+
+int main(int argc, char *argv[])
+{
+    run("spsc", 0, 1, 1);
+    run("mpmc", 1, 1, 1);
+    run("mpmc", 1, 2, 2);
+    run("mpmc", 1, 4, 4);
+    exit(0);
+}
@@ -0,0 +1,33 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Check that sleep(n) lasts n ticks even right after every
+// cpu has been idle, when no clock interrupt has counted
+// the ticks that went by.
+#define ROUNDS 5
+#define IDLE 30   // ticks to leave the machine idle
+#define NAP 10    // ticks to sleep after that
+
+int
+main(int argc, char *argv[])
+{
+  int t0, t1, bad = 0;
+
+  for(int r = 0; r < ROUNDS; r++){
+    sleep(IDLE);
+    t0 = uptime();
+    sleep(NAP);
+    t1 = uptime();
+    printf("sleeptest: sleep(%d) after %d idle ticks took %d ticks\n",
+           NAP, IDLE, t1 - t0);
+    if(t1 - t0 < NAP || t1 - t0 > NAP + 2)
+      bad++;
+  }
+  if(bad){
+    printf("sleeptest: FAIL\n");
+    exit(1);
+  }
+  printf("sleeptest: OK\n");
+  exit(0);
+}
@@ -0,0 +1,221 @@
+#include "kernel/types.h"
+#include "sync.h"
+#include "user.h"
+
+// Exponential backoff for spin loops: spin 1, 2, 4, ...
+// iterations between looks at the shared variable, up to
+// MAXDELAY, and after that yield the cpu each time round.
+// Yielding matters when there are more threads than harts:
+// the thread we wait for may be runnable but not running.
+#define MINDELAY 4
+#define MAXDELAY 1024
+
+static void
+backoff(int *delay)
+{
+    if (*delay >= MAXDELAY) {
+        sleep(0);
+        return;
+    }
+    for (volatile int i = 0; i < *delay; i++)
+        ;
+    *delay *= 2;
+}
+
+void
+ticketlock_init(struct ticketlock *l)
+{
+    l->next = 0;
+    l->owner = 0;
+}
+
+void
+ticketlock_acquire(struct ticketlock *l)
+{
+    uint me = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+    uint owner;
+    int delay = MINDELAY;
+
+    // Wait at least in proportion to the number of holders
+    // ahead of us, since we know it.
+    while ((owner = __atomic_load_n(&l->owner, __ATOMIC_ACQUIRE)) != me) {
+        if (delay < (me - owner) * MINDELAY)
+            delay = (me - owner) * MINDELAY;
+        backoff(&delay);
+    }
+}
+
+void
+ticketlock_release(struct ticketlock *l)
+{
+    // Only the holder writes owner.
+    __atomic_store_n(&l->owner, l->owner + 1, __ATOMIC_RELEASE);
+}
+
+void
+mcslock_init(struct mcslock *l)
+{
+    l->tail = 0;
+}
+
+// me must stay valid, usually on the caller's stack, until
+// the matching mcslock_release().
+void
+mcslock_acquire(struct mcslock *l, struct mcsnode *me)
+{
+    struct mcsnode *prev;
+    int delay = MINDELAY;
+
+    me->next = 0;
+    me->locked = 1;
+    prev = __atomic_exchange_n(&l->tail, me, __ATOMIC_ACQ_REL);
+    if (prev == 0)
+        return;
+    __atomic_store_n(&prev->next, me, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&me->locked, __ATOMIC_ACQUIRE))
+        backoff(&delay);
+}
+
+void
+mcslock_release(struct mcslock *l, struct mcsnode *me)
+{
+    struct mcsnode *next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE);
+    struct mcsnode *expect = me;
+    int delay = MINDELAY;
+
+    if (next == 0) {
+        // No known successor: try to mark the lock free.
+        if (__atomic_compare_exchange_n(&l->tail, &expect, 0, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return;
+        // Someone has swapped in behind us but not yet linked
+        // itself to our node.
+        while ((next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE)) == 0)
+            backoff(&delay);
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+void
+rwlock_init(struct rwlock *l)
+{
+    l->state = 0;
+    l->writers = 0;
+}
+
+void
+rwlock_rdlock(struct rwlock *l)
+{
+    int s, delay = MINDELAY;
+
+    for (;;) {
+        s = __atomic_load_n(&l->state, __ATOMIC_RELAXED);
+        if (s >= 0 && __atomic_load_n(&l->writers, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&l->state, &s, s + 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+        backoff(&delay);
+    }
+}
+
+void
+rwlock_rdunlock(struct rwlock *l)
+{
+    __atomic_fetch_sub(&l->state, 1, __ATOMIC_RELEASE);
+}
+
+void
+rwlock_wrlock(struct rwlock *l)
+{
+    int s, delay = MINDELAY;
+
+    __atomic_fetch_add(&l->writers, 1, __ATOMIC_RELAXED);
+    for (;;) {
+        s = 0;
+        if (__atomic_compare_exchange_n(&l->state, &s, -1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+        backoff(&delay);
+    }
+    __atomic_fetch_sub(&l->writers, 1, __ATOMIC_RELAXED);
+}
+
+void
+rwlock_wrunlock(struct rwlock *l)
+{
+    __atomic_store_n(&l->state, 0, __ATOMIC_RELEASE);
+}
+
+void
+barrier_init(struct barrier *b, int n)
+{
+    b->n = n;
+    b->count = 0;
+    b->sense = 0;
+}
+
+// Wait until b's n threads have all called barrier_wait().
+// The last to arrive resets the count and flips sense, which
+// releases the others; nobody can flip it again before every
+// thread of this round has arrived, so each thread's goal is
+// just the opposite of the sense it finds on arrival.
+void
+barrier_wait(struct barrier *b)
+{
+    int sense = !__atomic_load_n(&b->sense, __ATOMIC_ACQUIRE);
+    int delay = MINDELAY;
+
+    if (__atomic_add_fetch(&b->count, 1, __ATOMIC_ACQ_REL) == b->n) {
+        __atomic_store_n(&b->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&b->sense, sense, __ATOMIC_RELEASE);
+        futex_wake(&b->sense, b->n);
+        return;
+    }
+    while (__atomic_load_n(&b->sense, __ATOMIC_ACQUIRE) != sense) {
+        if (delay < MAXDELAY)
+            backoff(&delay);
+        else
+            futex_wait(&b->sense, !sense);
+    }
+}
+
+void
+sema_init(struct sema *s, int count)
+{
+    s->count = count;
+    s->waiters = 0;
+}
+
+void
+sema_down(struct sema *s)
+{
+    int c, delay = MINDELAY;
+
+    for (;;) {
+        c = __atomic_load_n(&s->count, __ATOMIC_RELAXED);
+        if (c > 0) {
+            if (__atomic_compare_exchange_n(&s->count, &c, c - 1, 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return;
+            continue;
+        }
+        if (delay < MAXDELAY) {
+            backoff(&delay);
+            continue;
+        }
+        // Sleep while count is 0. Counting ourselves first
+        // means a sema_up() either sees us or comes before
+        // futex_wait()'s look at count.
+        __atomic_fetch_add(&s->waiters, 1, __ATOMIC_SEQ_CST);
+        futex_wait(&s->count, 0);
+        __atomic_fetch_sub(&s->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void
+sema_up(struct sema *s)
+{
+    __atomic_fetch_add(&s->count, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->waiters, __ATOMIC_SEQ_CST) > 0)
+        futex_wake(&s->count, 1);
+}
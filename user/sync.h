@@ -0,0 +1,60 @@
+// Synchronization for threads that share memory. Needs
+// kernel/types.h first.
+//
+// All of these spin for a while, backing off exponentially,
+// then give up the cpu with sleep(0) or, where a releaser can
+// tell, sleep in futex_wait().
+
+// FIFO spin lock: each acquirer takes a number and waits for
+// it to be served.
+struct ticketlock {
+    uint next;
+    uint owner;
+};
+
+// MCS queue lock: each waiter spins on its own node, so a
+// release touches only the next waiter's cache line.
+struct mcsnode {
+    struct mcsnode *next;
+    int locked;
+};
+
+struct mcslock {
+    struct mcsnode *tail;
+};
+
+// Readers-writer lock. Waiting writers keep new readers out.
+struct rwlock {
+    int state;    // readers inside, or -1 for a writer
+    int writers;  // writers waiting
+};
+
+// Sense-reversing barrier for n threads.
+struct barrier {
+    int n;
+    int count;
+    int sense;
+};
+
+// Counting semaphore.
+struct sema {
+    int count;
+    int waiters;
+};
+
+void ticketlock_init(struct ticketlock *l);
+void ticketlock_acquire(struct ticketlock *l);
+void ticketlock_release(struct ticketlock *l);
+void mcslock_init(struct mcslock *l);
+void mcslock_acquire(struct mcslock *l, struct mcsnode *me);
+void mcslock_release(struct mcslock *l, struct mcsnode *me);
+void rwlock_init(struct rwlock *l);
+void rwlock_rdlock(struct rwlock *l);
+void rwlock_rdunlock(struct rwlock *l);
+void rwlock_wrlock(struct rwlock *l);
+void rwlock_wrunlock(struct rwlock *l);
+void barrier_init(struct barrier *b, int n);
+void barrier_wait(struct barrier *b);
+void sema_init(struct sema *s, int count);
+void sema_down(struct sema *s);
+void sema_up(struct sema *s);
@@ -0,0 +1,289 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "thread.h"
+#include "task.h"
+#include "user.h"
+
+// Each worker thread has a Chase-Lev deque of spawned tasks.
+// The owner pushes and takes at the bottom, without a lock
+// or an atomic instruction unless it is about to take the
+// last task; idle workers steal the oldest task from the top
+// of a random victim's deque. The thread that calls
+// task_init() is worker 0 and runs tasks while it waits in
+// task_sync().
+//
+// Workers with nothing to do, after a few rounds of failed
+// steals, sleep in futex_wait() on wakegen; task_spawn()
+// bumps it and wakes one of them, but only when some worker
+// has said it is idle, so a busy runtime spawns without
+// system calls.
+
+#define STEALTRIES 64  // failed steal rounds before a worker sleeps
+
+struct deque {
+    long top;         // next to steal; only ever increases
+    long bottom;      // next free slot, written only by the owner
+    struct task *buf[TASKDEQ];
+};
+
+struct worker {
+    struct deque dq;
+    uint64 rng;       // picks steal victims
+    int tid;
+} __attribute__((aligned(64)));
+
+static struct worker *workers;
+static int nworkers;
+static int stopping;
+static int nidle;     // workers asleep, or about to be
+static int wakegen;   // futex word for them
+static int selfkey = -1;
+
+// Chase and Lev, "Dynamic circular work-stealing deque", with
+// the memory orders of Le et al., "Correct and efficient
+// work-stealing for weak memory models".
+
+// Push t for the owner. Return 0 if the deque is full.
+static int
+dqpush(struct deque *dq, struct task *t)
+{
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+
+    if (b - top >= TASKDEQ)
+        return 0;
+    __atomic_store_n(&dq->buf[b % TASKDEQ], t, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+// Take the newest task, for the owner, or return 0.
+static struct task *
+dqtake(struct deque *dq)
+{
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+    long top;
+    struct task *t;
+
+    __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+    if (top > b) {
+        // Empty.
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    t = __atomic_load_n(&dq->buf[b % TASKDEQ], __ATOMIC_RELAXED);
+    if (top == b) {
+        // The last task: race the thieves for it.
+        if (!__atomic_compare_exchange_n(&dq->top, &top, top + 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            t = 0;
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return t;
+}
+
+// Steal the oldest task, for any worker, or return 0.
+static struct task *
+dqsteal(struct deque *dq)
+{
+    long top = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    long b;
+    struct task *t;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+    if (top >= b)
+        return 0;
+    t = __atomic_load_n(&dq->buf[top % TASKDEQ], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&dq->top, &top, top + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return 0;
+    return t;
+}
+
+static struct worker *
+self(void)
+{
+    return tls_get(selfkey);
+}
+
+static void
+run(struct task *t)
+{
+    t->fn(t->arg);
+    __atomic_store_n(&t->done, 1, __ATOMIC_RELEASE);
+}
+
+// Try to steal a task from some other worker, starting at a
+// random one.
+static struct task *
+steal(struct worker *w)
+{
+    struct task *t;
+    int i, v;
+
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+    v = w->rng % nworkers;
+    for (i = 0; i < nworkers; i++, v = (v + 1) % nworkers) {
+        if (&workers[v] != w && (t = dqsteal(&workers[v].dq)) != 0)
+            return t;
+    }
+    return 0;
+}
+
+static void *
+workerloop(void *arg)
+{
+    struct worker *w = arg;
+    struct task *t;
+    int fails = 0, gen;
+
+    tls_set(selfkey, w);
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        if ((t = dqtake(&w->dq)) != 0 || (t = steal(w)) != 0) {
+            run(t);
+            fails = 0;
+            continue;
+        }
+        if (++fails < STEALTRIES)
+            continue;
+
+        // Announce that we are idle before the last look, so
+        // that a task_spawn() racing with us either is seen
+        // here or sees nidle and wakes us.
+        gen = __atomic_load_n(&wakegen, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&nidle, 1, __ATOMIC_SEQ_CST);
+        if ((t = steal(w)) == 0 && !__atomic_load_n(&stopping, __ATOMIC_SEQ_CST))
+            futex_wait(&wakegen, gen);
+        __atomic_fetch_sub(&nidle, 1, __ATOMIC_SEQ_CST);
+        if (t)
+            run(t);
+        fails = 0;
+    }
+    return 0;
+}
+
+// Start n workers, counting the caller, which becomes worker
+// 0. Return 0, or -1 if n is out of range or a thread could
+// not be created.
+int
+task_init(int n)
+{
+    int i;
+
+    if (n < 1 || n > NCPU)
+        return -1;
+    if (selfkey < 0 && (selfkey = tls_alloc()) < 0)
+        return -1;
+    if ((workers = malloc(n * sizeof(struct worker))) == 0)
+        return -1;
+    memset(workers, 0, n * sizeof(struct worker));
+    nworkers = n;
+    stopping = 0;
+    nidle = 0;
+    for (i = 0; i < n; i++)
+        workers[i].rng = 2 * i + 1;
+    tls_set(selfkey, &workers[0]);
+    for (i = 1; i < n; i++) {
+        if ((workers[i].tid = thread_create(workerloop, &workers[i])) < 0) {
+            nworkers = i;
+            task_shutdown();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Stop the workers and wait for them. Every spawned task
+// must have been synced.
+void
+task_shutdown(void)
+{
+    int i;
+
+    __atomic_store_n(&stopping, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&wakegen, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&wakegen, nworkers);
+    for (i = 1; i < nworkers; i++)
+        thread_join(workers[i].tid, 0);
+    free(workers);
+    workers = 0;
+    nworkers = 0;
+}
+
+// Make fn(arg) available to run in parallel with the caller,
+// which must be a worker. If the caller's deque is full, run
+// it right away instead.
+void
+task_spawn(struct task *t, void (*fn)(void*), void *arg)
+{
+    t->fn = fn;
+    t->arg = arg;
+    t->done = 0;
+    if (!dqpush(&self()->dq, t)) {
+        run(t);
+        return;
+    }
+    // Order the push before the look at nidle; see workerloop().
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&nidle, __ATOMIC_SEQ_CST) > 0) {
+        __atomic_fetch_add(&wakegen, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&wakegen, 1);
+    }
+}
+
+// Wait for t to finish. If nobody has stolen it, it is the
+// newest task on the caller's deque and runs here; otherwise
+// run other tasks, ours or stolen, until the thief is done.
+void
+task_sync(struct task *t)
+{
+    struct worker *w = self();
+    struct task *u;
+
+    while (!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)) {
+        if ((u = dqtake(&w->dq)) != 0 || (u = steal(w)) != 0)
+            run(u);
+    }
+}
+
+struct forrange {
+    int lo, hi, grain;
+    void (*body)(int, void*);
+    void *arg;
+};
+
+static void
+forsplit(void *arg)
+{
+    struct forrange *r = arg;
+    struct forrange left, right;
+    struct task t;
+    int i;
+
+    if (r->hi - r->lo <= r->grain) {
+        for (i = r->lo; i < r->hi; i++)
+            r->body(i, r->arg);
+        return;
+    }
+    left = right = *r;
+    left.hi = right.lo = r->lo + (r->hi - r->lo) / 2;
+    task_spawn(&t, forsplit, &right);
+    forsplit(&left);
+    task_sync(&t);
+}
+
+// Call body(i, arg) for lo <= i < hi, in parallel, splitting
+// the range in halves down to pieces of grain iterations.
+void
+parallel_for(int lo, int hi, int grain, void (*body)(int, void*), void *arg)
+{
+    struct forrange r = { lo, hi, grain < 1 ? 1 : grain, body, arg };
+
+    forsplit(&r);
+}
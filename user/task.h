@@ -0,0 +1,18 @@
+// A work-stealing task runtime on top of thread_create().
+// Needs kernel/types.h and user/thread.h first.
+
+#define TASKDEQ 256  // tasks a worker can have spawned and not synced
+
+// A spawned call of fn(arg). The spawner owns the memory,
+// usually on its stack, until task_sync() returns.
+struct task {
+    void (*fn)(void*);
+    void *arg;
+    int done;
+};
+
+int task_init(int nworkers);
+void task_shutdown(void);
+void task_spawn(struct task *t, void (*fn)(void*), void *arg);
+void task_sync(struct task *t);
+void parallel_for(int lo, int hi, int grain, void (*body)(int, void*), void *arg);
@@ -0,0 +1,90 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "user/user.h"
+#include "user/thread.h"
+#include "user/task.h"
+
+// Time a divide-and-conquer workload, a recursive Fibonacci
+// spawning both halves down to a serial cutoff, on the task
+// runtime with 1 to NCPU workers, and report the speedup over
+// one worker. A parallel_for() pass checks the results.
+#define SPAWNDEPTH 16  // levels that spawn
+#define NFOR 4096
+
+struct fibarg {
+    int n;
+    uint64 r;
+};
+
+int cutoff;
+
+uint64 sfib(int n)
+{
+    return n < 2 ? n : sfib(n - 1) + sfib(n - 2);
+}
+
+void pfib(void *arg)
+{
+    struct fibarg *a = arg;
+    struct fibarg x, y;
+    struct task t;
+
+    if (a->n < cutoff) {
+        a->r = sfib(a->n);
+        return;
+    }
+    x.n = a->n - 1;
+    y.n = a->n - 2;
+    task_spawn(&t, pfib, &x);
+    pfib(&y);
+    task_sync(&t);
+    a->r = x.r + y.r;
+}
+
+uint64 squares[NFOR];
+
+void square(int i, void *arg)
+{
+    squares[i] = (uint64)i * i;
+}
+
+int main(int argc, char *argv[])
+{
+    struct fibarg a;
+    int n, t, base = 0, bad;
+    int fibn = argc > 1 ? atoi(argv[1]) : 30;
+    uint64 want = sfib(fibn);
+
+    cutoff = fibn - SPAWNDEPTH;
+    printf("fib(%d), cutoff %d\n", fibn, cutoff);
+    printf("workers  ticks  speedup\n");
+    for (n = 1; n <= NCPU; n++) {
+        if (task_init(n) < 0) {
+            printf("taskbench: task_init(%d) failed\n", n);
+            exit(1);
+        }
+        t = uptime();
+        a.n = fibn;
+        pfib(&a);
+        t = uptime() - t;
+        memset(squares, 0, sizeof(squares));
+        parallel_for(0, NFOR, 64, square, 0);
+        task_shutdown();
+
+        bad = a.r != want;
+        for (int i = 0; i < NFOR; i++)
+            if (squares[i] != (uint64)i * i)
+                bad++;
+        if (bad) {
+            printf("taskbench: %d workers: wrong results\n", n);
+            exit(1);
+        }
+        if (n == 1)
+            base = t;
+        if (t == 0)
+            t = 1;
+        printf("%d        %d      %d.%d%d\n", n, t, base / t,
+               base * 10 / t % 10, base * 100 / t % 10);
+    }
+    exit(0);
+}
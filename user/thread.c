@@ -3,33 +3,100 @@
 #include "thread.h"
 #include "user.h"
 
-#define PGSIZE 4096
+// The main thread starts with tp 0 and gets this block the
+// first time it asks.
+static struct tls maintls;
+static int ntlskeys;
+
+int clonestart(void (*start)(void*, void*), void *a, void *b);
+
+// A new thread starts here, from clonestart.S, on its own
+// stack, and runs start_routine(arg).
+static void __attribute__((noreturn))
+thread_start(void *start_routine, void *arg)
+{
+    void *(*fn)(void*) = start_routine;
+
+    // The thread's TLS block lives at the top of its own
+    // stack, for as long as the thread does.
+    struct tls tls;
+    memset(&tls, 0, sizeof(tls));
+    tls.self = &tls;
+    asm volatile("mv tp, %0" : : "r" (&tls) : "memory");
+    thread_exit(fn(arg));
+}
 
 int 
 thread_create(void *(start_routine)(void*), void *arg)
 {
-     // Allocate user stack
-    void *stack = (void*)malloc(PGSIZE);
-    if (!stack) {
-        //printf("Failed to allocate user stack");
-        return -1;
-    }
+    // Create child thread, on a stack of its own that the
+    // kernel grows on demand, behind a guard page, and frees
+    // when the thread exits.
+    return clonestart(thread_start, (void *)start_routine, arg);
+}
 
-    // Create child thread
-    int tid = clone(stack);
-    if (tid < 0 || tid > 20) {
-        //printf("Failed to create child thread");
-        free(stack);
+// Wait for thread tid to finish and store the value its start
+// routine returned or it passed to thread_exit() in *retval.
+// If the thread was cloned onto a stack the caller allocated,
+// free that too.
+int
+thread_join(int tid, void **retval)
+{
+    void *stack;
+
+    if (join(tid, retval, &stack) < 0)
         return -1;
+    if (stack)
+        free(stack);
+    return 0;
+}
+
+// Return the calling thread's TLS block.
+struct tls *
+thread_tls(void)
+{
+    struct tls *tls;
+
+    asm volatile("mv %0, tp" : "=r" (tls));
+    if (tls == 0) {
+        tls = &maintls;
+        tls->self = tls;
+        asm volatile("mv tp, %0" : : "r" (tls));
     }
-    else if (tid == 0) {
-        (*start_routine)(arg);
-        exit(0);
-    }
+    return tls;
+}
 
-    return 0;
+// Allocate a thread-local variable, initially 0 in every
+// thread. Return its key, or -1 if all NTLSKEY are in use.
+int
+tls_alloc(void)
+{
+    int key = __sync_fetch_and_add(&ntlskeys, 1);
+
+    return key < NTLSKEY ? key : -1;
 }
 
+void *
+tls_get(int key)
+{
+    return thread_tls()->key[key];
+}
+
+void
+tls_set(int key, void *value)
+{
+    thread_tls()->key[key] = value;
+}
+
+// lock->locked is 0 when the lock is free, 1 when it is held
+// and nobody waits, and 2 when it is held and some thread may
+// be asleep in futex_wait() on it. A contended acquire spins
+// for a while, in case the holder is about to let go, and
+// then sleeps; lock_release() makes a futex_wake() call only
+// when the lock was 2, so an uncontended lock never enters
+// the kernel.
+#define LOCK_SPINS 100
+
 void 
 lock_init(struct lock_t* lock)
 {
@@ -39,19 +106,32 @@ lock_init(struct lock_t* lock)
 void 
 lock_acquire(struct lock_t* lock)
 {
-    // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
-    //   a5 = 1
-    //   s1 = &lock->locked
-    //   amoswap.w.aq a5, a5, (s1)
-    while(__sync_lock_test_and_set(&lock->locked, 1) != 0)
-    ;
+    uint c;
+
+    // On RISC-V, sync_val_compare_and_swap turns into an
+    // lr.w/sc.w loop.
+    for (int i = 0; i < LOCK_SPINS; i++) {
+        if ((c = __sync_val_compare_and_swap(&lock->locked, 0, 1)) == 0)
+            goto acquired;
+        if (c == 2)
+            break;
+    }
+
+    // Mark the lock contended and sleep until it is free.
+    // Taking it as 2 rather than 1 is conservative: the
+    // releaser then wakes someone who may not exist.
+    // On RISC-V, sync_lock_test_and_set turns into an atomic swap.
+    while (__sync_lock_test_and_set(&lock->locked, 2) != 0)
+        futex_wait((int*)&lock->locked, 2);
 
+acquired:
     // Tell the C compiler and the processor to not move loads or stores
     // past this point, to ensure that the critical section's memory
     // references happen strictly after the lock is acquired.
     // On RISC-V, this emits a fence instruction.
     __sync_synchronize();
 }
+
 void 
 lock_release(struct lock_t* lock)
 {
@@ -63,12 +143,10 @@ lock_release(struct lock_t* lock)
     // On RISC-V, this emits a fence instruction.
     __sync_synchronize();
 
-    // Release the lock, equivalent to lk->locked = 0.
-    // This code doesn't use a C assignment, since the C standard
+    // Release the lock with an atomic swap, since the C standard
     // implies that an assignment might be implemented with
-    // multiple store instructions.
-    // On RISC-V, sync_lock_release turns into an atomic swap:
-    //   s1 = &lk->locked
-    //   amoswap.w zero, zero, (s1)
-    __sync_lock_release(&lock->locked);
-}
\ No newline at end of file
+    // multiple store instructions. If there were waiters,
+    // hand the lock to one of them.
+    if (__sync_lock_test_and_set(&lock->locked, 0) == 2)
+        futex_wake((int*)&lock->locked, 1);
+}
@@ -2,7 +2,21 @@ struct lock_t {
      uint locked;
 };
 
+#define NTLSKEY 16  // thread-local variables per program
+
+// A thread's thread-local storage block. Its tp register
+// points here, so reaching it takes no lock or system call.
+struct tls {
+    struct tls *self;
+    void *key[NTLSKEY];
+};
+
 int thread_create(void *(start_routine)(void*), void *arg);
+int thread_join(int tid, void **retval);
 void lock_init(struct lock_t* lock);
 void lock_acquire(struct lock_t* lock);
-void lock_release(struct lock_t* lock);
\ No newline at end of file
+void lock_release(struct lock_t* lock);
+struct tls *thread_tls(void);
+int tls_alloc(void);
+void *tls_get(int key);
+void tls_set(int key, void *value);
\ No newline at end of file
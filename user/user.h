@@ -1,4 +1,5 @@
 struct stat;
+struct memstat;
 struct pinfo;
 
 // system calls
@@ -28,6 +29,16 @@ int procinfo(struct pinfo*);
 int sched_statistics(void);
 int sched_tickets(int);
 int clone(void*);
+int sched_policy(int, int);
+int sched_nice(int, int);
+int sched_deadline(int, int, int);
+int sched_quantum(int, int);
+int futex_wait(int*, int);
+int futex_wake(int*, int);
+void thread_exit(void*) __attribute__((noreturn));
+int join(int, void**, void**);
+int sched_gang(int);
+int memstat(struct memstat*);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -40,4 +40,14 @@ entry("sysinfo");
 entry("procinfo");
 entry("sched_statistics"); 
 entry("sched_tickets"); 
-entry("clone"); 
\ No newline at end of file
+entry("clone");
+entry("sched_policy");
+entry("sched_nice");
+entry("sched_deadline");
+entry("sched_quantum");
+entry("futex_wait");
+entry("futex_wake");
+entry("thread_exit");
+entry("join");
+entry("sched_gang");
+entry("memstat");
\ No newline at end of file